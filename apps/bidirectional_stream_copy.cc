@@ -5,7 +5,9 @@
 
 #include <algorithm>
 #include <iostream>
+#include <string_view>
 #include <unistd.h>
+#include <vector>
 
 using namespace std;
 
@@ -13,13 +15,14 @@ void bidirectional_stream_copy( Socket& socket )
 {
   constexpr size_t buffer_size = 1048576;
 
-  EventLoop _eventloop {};
+  EventLoop _eventloop { EventLoop::Backend::Poll, EventLoop::Dispatch::AllReady };
   FileDescriptor _input { STDIN_FILENO };
   FileDescriptor _output { STDOUT_FILENO };
   ByteStream _outbound { buffer_size };
   ByteStream _inbound { buffer_size };
   bool _outbound_shutdown { false };
   bool _inbound_shutdown { false };
+  vector<string_view> _iov {};
 
   socket.set_blocking( false );
   _input.set_blocking( false );
@@ -52,7 +55,8 @@ void bidirectional_stream_copy( Socket& socket )
     Direction::Out,
     [&] {
       if ( _outbound.reader().bytes_buffered() ) {
-        _outbound.reader().pop( socket.write( _outbound.reader().peek() ) );
+        _outbound.reader().peek_iov( _iov );
+        _outbound.reader().pop( socket.write( _iov ) );
       }
       if ( _outbound.reader().is_finished() ) {
         socket.shutdown( SHUT_WR );
@@ -91,7 +95,8 @@ void bidirectional_stream_copy( Socket& socket )
     Direction::Out,
     [&] {
       if ( _inbound.reader().bytes_buffered() ) {
-        _inbound.reader().pop( _output.write( _inbound.reader().peek() ) );
+        _inbound.reader().peek_iov( _iov );
+        _inbound.reader().pop( _output.write( _iov ) );
       }
       if ( _inbound.reader().is_finished() ) {
         _output.close();
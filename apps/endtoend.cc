@@ -87,11 +87,18 @@ private:
   NetworkInterface _interface;
   Address _next_hop;
   pair<FileDescriptor, FileDescriptor> _data_socket_pair = socket_pair_helper( SOCK_DGRAM );
+  vector<vector<Buffer>> _frames {};
+  vector<vector<string>> _read_slots {};
 
+  // Frames the socket couldn't take last time stay queued and go first
   void send_pending()
   {
     while ( auto frame = _interface.maybe_send() ) {
-      _data_socket_pair.first.write( serialize( frame.value() ) );
+      _frames.push_back( serialize( frame.value() ) );
+    }
+    if ( not _frames.empty() ) {
+      const size_t sent = _data_socket_pair.first.send_datagrams( _frames );
+      _frames.erase( _frames.begin(), _frames.begin() + static_cast<ptrdiff_t>( sent ) );
     }
   }
 
@@ -121,11 +128,46 @@ public:
 
     return {};
   }
+  void read( vector<TCPSegment>& segs )
+  {
+    _read_slots.resize( MAX_READ_BATCH );
+    for ( auto& slot : _read_slots ) {
+      slot.resize( 3 );
+      slot.at( 0 ).resize( EthernetHeader::LENGTH );
+      slot.at( 1 ).resize( IPv4Header::LENGTH );
+      slot.at( 2 ).clear();
+    }
+
+    const size_t count = _data_socket_pair.first.recv_datagrams( _read_slots );
+    for ( size_t i = 0; i < count; i++ ) {
+      EthernetFrame frame;
+      vector<Buffer> buffers;
+      ranges::transform( _read_slots[i], back_inserter( buffers ), identity() );
+      if ( not parse( frame, buffers ) ) {
+        continue;
+      }
+      if ( auto ip_dgram = _interface.recv_frame( frame ) ) {
+        if ( auto seg = unwrap_tcp_in_ip( ip_dgram.value() ) ) {
+          segs.push_back( move( seg.value() ) );
+        }
+      }
+    }
+
+    send_pending();
+  }
   void write( TCPSegment& seg )
   {
     _interface.send_datagram( wrap_tcp_in_ip( seg ), _next_hop );
     send_pending();
   }
+  size_t write( vector<TCPSegment>& segs )
+  {
+    for ( auto& seg : segs ) {
+      _interface.send_datagram( wrap_tcp_in_ip( seg ), _next_hop );
+    }
+    send_pending();
+    return segs.size();
+  }
   void tick( const size_t ms_since_last_tick )
   {
     _interface.tick( ms_since_last_tick );
@@ -232,8 +274,7 @@ void program_body( bool is_client, const string& bounce_host, const string& boun
         if ( debug ) {
           cerr << "     Host->router:     " << summary( frame ) << "\n";
         }
-        router.interface( host_side ).recv_frame( frame );
-        router.route();
+        router.recv_frame( host_side, move( frame ) );
       } );
 
       // Frames from router to host
@@ -276,8 +317,7 @@ void program_body( bool is_client, const string& bounce_host, const string& boun
         if ( debug ) {
           cerr << "     Internet->router: " << summary( frame ) << "\n";
         }
-        router.interface( internet_side ).recv_frame( frame );
-        router.route();
+        router.recv_frame( internet_side, move( frame ) );
       } );
 
       while ( true ) {
@@ -45,6 +45,7 @@ ttest(recv_reorder)
 ttest(recv_reorder_more)
 ttest(recv_close)
 ttest(recv_special)
+ttest(recv_sack)
 
 ttest(send_connect)
 ttest(send_transmit)
@@ -53,11 +54,21 @@ ttest(send_window)
 ttest(send_ack)
 ttest(send_close)
 ttest(send_extra)
+ttest(send_sack)
+ttest(send_congestion)
+ttest(send_nagle)
+
+ttest(peer_delayed_ack)
 
 ttest(net_interface)
 
 ttest(router)
 
+ttest(timer_wheel)
+ttest(eventloop)
+ttest(checksum)
+ttest(tcp_segment)
+
 add_custom_target (check0 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 12 -R 'webget|^byte_stream_')
 
 add_custom_target (check_webget COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --timeout 12 -R 'webget')
@@ -90,3 +101,6 @@ set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
 stest(reassembler_speed_test)
+stest(datagram_write_speed_test)
+stest(checksum_speed_test)
+stest(router_speed_test)
@@ -7,15 +7,36 @@
 
 using namespace std;
 
-ByteStream::ByteStream(uint64_t capacity) : capacity_(capacity) {}
+ByteStream::ByteStream(uint64_t capacity, Storage storage)
+  : capacity_(capacity), storage_(storage)
+{
+  if (storage_ == Storage::Ring) {
+    buffer_.resize(capacity_);
+  }
+}
 
 void Writer::push(string data)
 {
-  const uint64_t count = min(capacity_, data.size());
-  data.resize(count);
-  byte_stream_.append(data);
+  const uint64_t count = min(available_capacity(), data.size());
+  if (count == 0) {
+    return;
+  }
+
+  if (storage_ == Storage::Chunked) {
+    // Keep the caller's string as the chunk; no bytes are copied
+    data.resize(count);
+    chunks_.emplace_back(std::move(data));
+    push_count_ += count;
+    return;
+  }
+
+  // Copy into the free region, which starts right after the buffered bytes
+  // and may wrap around the end of the storage
+  const uint64_t tail = (head_ + push_count_ - pop_count_) % capacity_;
+  const uint64_t first_part = min(count, capacity_ - tail);
+  data.copy(buffer_.data() + tail, first_part);
+  data.copy(buffer_.data(), count - first_part, first_part);
   push_count_ += count;
-  capacity_ -= count;
 }
 
 void Writer::close()
@@ -35,7 +56,7 @@ bool Writer::is_closed() const
 
 uint64_t Writer::available_capacity() const
 {
-  return capacity_;
+  return capacity_ - (push_count_ - pop_count_);
 }
 
 uint64_t Writer::bytes_pushed() const
@@ -48,12 +69,15 @@ string_view Reader::peek() const
   // The string view must reference to the underlying byte
   // of the byte stream. Got memory error if let string_view
   // refer to a local variable
-  return {byte_stream_};
+  if (storage_ == Storage::Chunked) {
+    return chunks_.empty() ? string_view {} : string_view {chunks_.front()}.substr(head_);
+  }
+  return {buffer_.data() + head_, min(bytes_buffered(), capacity_ - head_)};
 }
 
 bool Reader::is_finished() const
 {
-  return close_ && byte_stream_.empty();
+  return close_ && bytes_buffered() == 0;
 }
 
 bool Reader::has_error() const
@@ -63,17 +87,96 @@ bool Reader::has_error() const
 
 void Reader::pop(uint64_t len)
 {
-  const uint64_t count = min(byte_stream_.size(), len);
-  using difference_type = decltype(byte_stream_.begin())::difference_type;
-  byte_stream_.erase(byte_stream_.begin(),
-                     byte_stream_.begin() + static_cast<difference_type>(count));
+  const uint64_t count = min(bytes_buffered(), len);
   pop_count_ += count;
-  capacity_ += count;
+
+  if (storage_ == Storage::Chunked) {
+    uint64_t remaining = count;
+    while (remaining > 0) {
+      const uint64_t to_pop_now = min(remaining, chunks_.front().size() - head_);
+      head_ += to_pop_now;
+      remaining -= to_pop_now;
+      if (head_ == chunks_.front().size()) {
+        chunks_.pop_front();
+        head_ = 0;
+      }
+    }
+    return;
+  }
+
+  // Rewind to the start of the storage once the buffer drains, so that
+  // the next peek() sees as long a contiguous region as possible
+  head_ = bytes_buffered() == 0 ? 0 : (head_ + count) % capacity_;
+}
+
+Buffer Reader::pop_buffer(uint64_t len)
+{
+  // Hand over the untouched front chunk when it is exactly what is being removed. When the
+  // removal spans several chunks, gather them into one copy instead, so that a caller sizing
+  // segments gets as many bytes as it asked for, not just the front chunk.
+  if (storage_ == Storage::Chunked && !chunks_.empty() && head_ == 0
+      && chunks_.front().size() == min(len, bytes_buffered())) {
+    Buffer chunk = std::move(chunks_.front());
+    chunks_.pop_front();
+    pop_count_ += chunk.size();
+    return chunk;
+  }
+
+  string out;
+  out.reserve(min(len, bytes_buffered()));
+  read(*this, len, out);
+  return Buffer {std::move(out)};
+}
+
+void Reader::peek_iov(vector<string_view>& out) const
+{
+  out.clear();
+  if (storage_ == Storage::Chunked) {
+    for (const auto& chunk : chunks_) {
+      out.emplace_back(chunk);
+    }
+    if (!out.empty()) {
+      out.front().remove_prefix(head_);
+    }
+    return;
+  }
+
+  // At most two regions: up to the end of the storage, then from its start
+  const string_view first = peek();
+  if (!first.empty()) {
+    out.push_back(first);
+  }
+  if (first.size() < bytes_buffered()) {
+    out.emplace_back(buffer_.data(), bytes_buffered() - first.size());
+  }
+}
+
+void Reader::pop_buffers(uint64_t len, vector<Buffer>& out)
+{
+  out.clear();
+  if (storage_ == Storage::Ring) {
+    if (bytes_buffered() > 0 && len > 0) {
+      out.push_back(pop_buffer(len));
+    }
+    return;
+  }
+
+  len = min(len, bytes_buffered());
+  while (len > 0) {
+    if (head_ == 0 && chunks_.front().size() <= len) {
+      out.push_back(pop_buffer(len));
+    } else {
+      // Copy only the part of the front chunk that is being removed
+      out.emplace_back(string {peek().substr(0, len)});
+      pop(out.back().size());
+    }
+    len -= out.back().size();
+  }
 }
 
 uint64_t Reader::bytes_buffered() const
 {
-  return byte_stream_.size();
+  return push_count_ - pop_count_;
 }
 
 uint64_t Reader::bytes_popped() const
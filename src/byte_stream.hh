@@ -1,29 +1,50 @@
 #pragma once
 
+#include "buffer.hh"
+
 #include <cstdint>
+#include <deque>
 #include <queue>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <vector>
 
 class Reader;
 class Writer;
 
 class ByteStream
 {
+public:
+  // How the ByteStream keeps its buffered bytes:
+  //   Ring:    a fixed-size circular buffer; each push copies into it
+  //   Chunked: a queue of the pushed strings, kept as-is; peek() returns the front chunk and
+  //            pop_buffer() can hand over a whole chunk without copying it
+  enum class Storage
+  {
+    Ring,
+    Chunked
+  };
+
 protected:
   uint64_t capacity_;
   // Please add any additional state to the ByteStream here, and not to the Writer and Reader
   // interfaces.
   bool close_ {};
   bool error_ {};
-  // std::queue<char> byte_stream_ {};
-  std::string byte_stream_ {};
+  Storage storage_;
+  // Ring storage: fixed-size circular buffer, allocated once at construction. Buffered bytes
+  // start at `head_` and may wrap around the end of the storage.
+  std::string buffer_ {};
+  // Chunked storage: pushed strings in order. Buffered bytes start `head_` bytes into the front
+  // chunk.
+  std::deque<Buffer> chunks_ {};
+  uint64_t head_ {};
   uint64_t push_count_ {};
   uint64_t pop_count_ {};
 
 public:
-  explicit ByteStream(uint64_t capacity);
+  explicit ByteStream(uint64_t capacity, Storage storage = Storage::Ring);
 
   // Helper functions (provided) to access the ByteStream's Reader and Writer interfaces
   Reader& reader();
@@ -49,8 +70,23 @@ public:
 class Reader : public ByteStream
 {
 public:
-  std::string_view peek() const; // Peek at the next bytes in the buffer
-  void pop(uint64_t len);        // Remove `len` bytes from the buffer
+  // Peek at the next bytes in the buffer. The view ends at the wrap point (Ring) or at the end
+  // of the front chunk (Chunked), so it may be shorter than bytes_buffered().
+  std::string_view peek() const;
+  void pop(uint64_t len); // Remove `len` bytes from the buffer
+
+  // Remove up to `len` bytes from the buffer and return them. With Chunked storage, a front
+  // chunk that holds exactly the bytes removed is handed over without copying; bytes gathered
+  // from several chunks (or part of one) are copied into one Buffer.
+  Buffer pop_buffer(uint64_t len);
+
+  // Views of every buffered byte, in order (e.g. for one writev). Unlike peek(), the views
+  // together cover bytes_buffered(). They are invalidated by the next push or pop.
+  void peek_iov(std::vector<std::string_view>& out) const;
+
+  // Remove up to `len` bytes from the buffer into `out`. With Chunked storage, whole chunks are
+  // moved over without copying; only a chunk that is split by the first or last byte is copied.
+  void pop_buffers(uint64_t len, std::vector<Buffer>& out);
 
   bool is_finished() const; // Is the stream finished (closed and fully popped)?
   bool has_error() const;   // Has the stream had an error?
@@ -0,0 +1,111 @@
+#include "congestion_control.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+using namespace std;
+
+unique_ptr<CongestionControl> CongestionControl::make(CongestionControlAlgorithm algorithm,
+                                                      uint64_t mss)
+{
+  switch (algorithm) {
+    case CongestionControlAlgorithm::NEWRENO:
+      return make_unique<NewReno>(mss);
+    case CongestionControlAlgorithm::CUBIC:
+      return make_unique<Cubic>(mss);
+    case CongestionControlAlgorithm::NONE:
+      break;
+  }
+  return make_unique<NoCongestionControl>(mss);
+}
+
+void NewReno::on_ack(uint64_t bytes_acked, uint64_t)
+{
+  // Slow start: grow by at most one segment per ACK (RFC 5681)
+  if (in_slow_start()) {
+    cwnd_ += min(bytes_acked, mss_);
+    return;
+  }
+
+  // Congestion avoidance: grow by one segment per window of acknowledged data
+  bytes_acked_ += bytes_acked;
+  if (bytes_acked_ >= cwnd_) {
+    bytes_acked_ -= cwnd_;
+    cwnd_ += mss_;
+  }
+}
+
+void NewReno::on_loss(uint64_t bytes_in_flight, uint64_t)
+{
+  // The three duplicate ACKs each mean a segment has left the network (RFC 6582 step 2)
+  ssthresh_ = max(bytes_in_flight / 2, 2 * mss_);
+  cwnd_ = ssthresh_ + 3 * mss_;
+  bytes_acked_ = 0;
+}
+
+void NewReno::on_rto(uint64_t bytes_in_flight, uint64_t)
+{
+  ssthresh_ = max(bytes_in_flight / 2, 2 * mss_);
+  cwnd_ = mss_;
+  bytes_acked_ = 0;
+}
+
+void Cubic::on_ack(uint64_t bytes_acked, uint64_t now_ms)
+{
+  if (in_slow_start()) {
+    cwnd_ += min(bytes_acked, mss_);
+    return;
+  }
+
+  const double cwnd_segments = segments();
+  if (!epoch_started_) {
+    // First congestion avoidance ACK since slow start or a reduction
+    epoch_started_ = true;
+    epoch_start_ms_ = now_ms;
+    if (w_max_ < cwnd_segments) {
+      w_max_ = cwnd_segments;
+      k_ = 0;
+    } else {
+      k_ = cbrt((w_max_ - cwnd_segments) / C);
+    }
+    w_est_ = cwnd_segments;
+  }
+
+  // W_cubic(t) = C * (t - K)^3 + W_max
+  const double t = static_cast<double>(now_ms - epoch_start_ms_) / 1000.0;
+  const double w_cubic = C * pow(t - k_, 3) + w_max_;
+
+  // Reno-friendly region: grow w_est like standard TCP would (RFC 9438 section 4.3)
+  const double acked_segments = static_cast<double>(bytes_acked) / static_cast<double>(mss_);
+  w_est_ += 3 * (1 - BETA) / (1 + BETA) * acked_segments / cwnd_segments;
+
+  const double target = max(w_cubic, w_est_);
+  if (target > cwnd_segments) {
+    // Approach the target over one window's worth of ACKs
+    const double increase = (target - cwnd_segments) / cwnd_segments * acked_segments;
+    cwnd_ += max<uint64_t>(1, static_cast<uint64_t>(increase * static_cast<double>(mss_)));
+  }
+}
+
+void Cubic::reduce(uint64_t bytes_in_flight)
+{
+  const double cwnd_segments = segments();
+  // Fast convergence: release bandwidth sooner if the window shrank since the last loss
+  w_max_ = cwnd_segments < w_max_ ? cwnd_segments * (1 + BETA) / 2 : cwnd_segments;
+  ssthresh_ = max(static_cast<uint64_t>(static_cast<double>(bytes_in_flight) * BETA), 2 * mss_);
+  epoch_started_ = false;
+}
+
+void Cubic::on_loss(uint64_t bytes_in_flight, uint64_t)
+{
+  reduce(bytes_in_flight);
+  cwnd_ = ssthresh_;
+}
+
+void Cubic::on_rto(uint64_t bytes_in_flight, uint64_t)
+{
+  reduce(bytes_in_flight);
+  cwnd_ = mss_;
+}
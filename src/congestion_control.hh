@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+enum class CongestionControlAlgorithm
+{
+  NONE,    // no congestion window; only the receiver's window limits the sender
+  NEWRENO, // RFC 5681 slow start and congestion avoidance, RFC 6582 fast recovery
+  CUBIC,   // RFC 9438
+};
+
+/*
+ * A congestion controller keeps the congestion window (cwnd) and slow-start threshold
+ * (ssthresh) of one TCP connection, both measured in sequence numbers. TCPSender never lets
+ * more than cwnd() sequence numbers be in flight, and reports each ACK, loss and timeout.
+ *
+ * All times are in milliseconds since the sender was created.
+ */
+class CongestionControl
+{
+protected:
+  uint64_t mss_;
+  uint64_t cwnd_;
+  uint64_t ssthresh_ {UINT64_MAX};
+
+  bool in_slow_start() const { return cwnd_ < ssthresh_; }
+
+public:
+  /* The initial window is ten segments (RFC 6928) */
+  static constexpr uint64_t INITIAL_WINDOW_SEGMENTS = 10;
+
+  explicit CongestionControl(uint64_t mss)
+    : mss_(mss), cwnd_(INITIAL_WINDOW_SEGMENTS * mss)
+  {}
+  virtual ~CongestionControl() = default;
+
+  CongestionControl(const CongestionControl& other) = default;
+  CongestionControl& operator=(const CongestionControl& other) = default;
+
+  /* New data was acknowledged (not called during fast recovery) */
+  virtual void on_ack(uint64_t bytes_acked, uint64_t now_ms) = 0;
+
+  /* A loss was detected by duplicate ACKs or SACK; fast recovery begins */
+  virtual void on_loss(uint64_t bytes_in_flight, uint64_t now_ms) = 0;
+
+  /* Fast recovery (RFC 6582 section 3.2, steps 3 to 5). Each further duplicate ACK means
+   * another segment has left the network, so the window inflates by one segment and new
+   * data can go out during recovery. */
+  void on_recovery_dup_ack() { cwnd_ += mss_; }
+
+  /* A partial ACK of `bytes_acked`: deflate by that much, adding back one segment if at least
+   * one was acknowledged */
+  void on_partial_ack(uint64_t bytes_acked)
+  {
+    cwnd_ -= std::min(bytes_acked, cwnd_);
+    if (bytes_acked >= mss_) {
+      cwnd_ += mss_;
+    }
+    cwnd_ = std::max(cwnd_, mss_);
+  }
+
+  /* Everything outstanding at the loss was acknowledged: deflate the window to ssthresh */
+  void on_recovery_end() { cwnd_ = ssthresh_; }
+
+  /* The retransmission timer expired */
+  virtual void on_rto(uint64_t bytes_in_flight, uint64_t now_ms) = 0;
+
+  /* The connection settled on a segment size (before sending any data); restart from the
+   * initial window for that size */
+  void set_mss(uint64_t mss)
+  {
+    mss_ = mss;
+    cwnd_ = INITIAL_WINDOW_SEGMENTS * mss;
+  }
+
+  /* Largest number of sequence numbers that may be in flight */
+  virtual uint64_t cwnd() const { return cwnd_; }
+  uint64_t ssthresh() const { return ssthresh_; }
+
+  /* Make the controller for `algorithm` */
+  static std::unique_ptr<CongestionControl> make(CongestionControlAlgorithm algorithm,
+                                                 uint64_t mss);
+};
+
+/* Leaves the sender limited by the receiver's window alone */
+class NoCongestionControl : public CongestionControl
+{
+public:
+  using CongestionControl::CongestionControl;
+
+  void on_ack(uint64_t, uint64_t) override {}
+  void on_loss(uint64_t, uint64_t) override {}
+  void on_rto(uint64_t, uint64_t) override {}
+  uint64_t cwnd() const override { return UINT64_MAX; }
+};
+
+/* RFC 5681 and RFC 6582: halve the window on a loss, then inflate it by one segment for each
+ * of the three duplicate ACKs that signalled the loss and for each one after */
+class NewReno : public CongestionControl
+{
+  // bytes acknowledged since cwnd last grew in congestion avoidance
+  uint64_t bytes_acked_ {};
+
+public:
+  using CongestionControl::CongestionControl;
+
+  void on_ack(uint64_t bytes_acked, uint64_t now_ms) override;
+  void on_loss(uint64_t bytes_in_flight, uint64_t now_ms) override;
+  void on_rto(uint64_t bytes_in_flight, uint64_t now_ms) override;
+};
+
+/* RFC 9438: the window drops straight to ssthresh on a loss, then follows the same fast
+ * recovery */
+class Cubic : public CongestionControl
+{
+  static constexpr double C = 0.4;    // scaling constant, in segments per second cubed
+  static constexpr double BETA = 0.7; // multiplicative decrease factor
+
+  double w_max_ {};          // window (in segments) just before the last reduction
+  double k_ {};              // seconds the cubic function takes to grow back to w_max_
+  double w_est_ {};          // estimate of the window standard TCP would have (in segments)
+  uint64_t epoch_start_ms_ {};
+  bool epoch_started_ {};
+
+  double segments() const { return static_cast<double>(cwnd_) / static_cast<double>(mss_); }
+
+  void reduce(uint64_t bytes_in_flight);
+
+public:
+  using CongestionControl::CongestionControl;
+
+  void on_ack(uint64_t bytes_acked, uint64_t now_ms) override;
+  void on_loss(uint64_t bytes_in_flight, uint64_t now_ms) override;
+  void on_rto(uint64_t bytes_in_flight, uint64_t now_ms) override;
+};
@@ -12,6 +12,7 @@
 #include <iostream>
 #include <optional>
 #include <utility>
+#include <vector>
 
 using namespace std;
 
@@ -71,6 +72,24 @@ void NetworkInterface::send_datagram(const InternetDatagram& dgram, const Addres
   unresolved_dgrams_[next_hop_ip_address] = {dgram, time_};
 }
 
+// dgram: the serialized IPv4 datagram, which becomes the frame's payload without being copied
+void NetworkInterface::send_serialized_datagram(vector<Buffer> dgram, const Address& next_hop)
+{
+  const auto it = address_map_.find(next_hop.ipv4_numeric());
+  if (it == address_map_.end()) {
+    // The datagram has to wait for an ARP reply; queue it the usual way
+    InternetDatagram parsed;
+    if (parse(parsed, dgram)) {
+      send_datagram(parsed, next_hop);
+    }
+    return;
+  }
+
+  const EthernetHeader header {
+    .dst = it->second.first, .src = ethernet_address_, .type = EthernetHeader::TYPE_IPv4};
+  sent_frames_.push({.header = header, .payload = std::move(dgram)});
+}
+
 // frame: the incoming Ethernet frame
 optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame& frame)
 {
@@ -9,6 +9,7 @@
 #include <queue>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 // A "network interface" that connects IP (the internet layer, or network layer)
 // with Ethernet (the network access layer, or link layer).
@@ -70,6 +71,10 @@ public:
   // but please consider the frame sent as soon as it is generated.)
   void send_datagram(const InternetDatagram& dgram, const Address& next_hop);
 
+  // Sends an IPv4 datagram that is already serialized, as is, when the next hop's Ethernet address
+  // is known. Otherwise parses it and falls back to send_datagram() to resolve the address.
+  void send_serialized_datagram(std::vector<Buffer> dgram, const Address& next_hop);
+
   // Receives an Ethernet frame and responds appropriately.
   // If type is IPv4, returns the datagram.
   // If type is ARP request, learn a mapping from the "sender" fields, and send an ARP reply.
@@ -78,4 +83,6 @@ public:
 
   // Called periodically when time elapses
   void tick(size_t ms_since_last_tick);
+
+  const EthernetAddress& ethernet_address() const { return ethernet_address_; }
 };
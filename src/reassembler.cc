@@ -2,8 +2,10 @@
 
 #include "byte_stream.hh"
 
+#include <algorithm>
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <utility>
 
 using namespace std;
@@ -20,79 +22,52 @@ void Reassembler::insert(uint64_t first_index, string data, bool is_last_substri
   // This check handle three cases:
   // - Empty segment
   // - Already assembled segment
-  // - Segment that can't fit in the assembler's underlying storage
+  // - Segment that can't fit in the assembler's underlying storage (or no storage at all)
   if (first_index + data.size() <= first_unassembled_index_
-      || first_index >= first_unacceptable_index) {
+      || first_index >= first_unacceptable_index || available_capacity == 0) {
     try_close_stream(output);
     return;
   }
 
-  // Trim bytes that were already assembled
+  // Fast path: the segment carries the next part of the stream, so hand the string straight
+  // to the output. Any buffered bytes it covers are now redundant and are discarded.
   if (first_index <= first_unassembled_index_) {
-    const uint64_t assembled_bytes = first_unassembled_index_ - first_index;
+    data.erase(0, first_unassembled_index_ - first_index);
     first_index = first_unassembled_index_;
-    data = data.substr(assembled_bytes);
-  }
-
-  // Trim bytes that can't fit in the assembler's storage
-  if (first_index + data.size() > first_unacceptable_index) {
-    data.resize(first_unacceptable_index - first_index);
-  }
-
-  auto it = buffer_.upper_bound(first_index);
-  const uint64_t last_index = first_index + data.size() - 1;
-
-  // Check the segment before this new segment
-  if (it != buffer_.begin()) {
-    auto prev = it;
-    prev--;
-    const uint64_t prev_last_index = prev->first + prev->second.size() - 1;
-    // New segment is already covered by a previous segment
-    if (last_index <= prev_last_index) {
-      return;
+    data.resize(min<uint64_t>(data.size(), available_capacity));
+    const uint64_t end = first_index + data.size();
+    auto covered = pending_.begin();
+    while (covered != pending_.end() && covered->second <= end) {
+      num_bytes_pending_ -= covered->second - covered->first;
+      ++covered;
     }
-    // Trim the previous segment
-    if (prev_last_index >= first_index) {
-      const uint64_t remaining_bytes = first_index - prev->first;
-      const uint64_t overlapping_bytes = prev->second.size() - remaining_bytes;
-      num_bytes_pending_ -= overlapping_bytes;
-      // We can either keep empty segment in the assembler or delete it
-      if (remaining_bytes == 0) {
-        buffer_.erase(prev);
-      } else {
-        prev->second.resize(remaining_bytes);
-      }
+    if (covered != pending_.end() && covered->first < end) {
+      num_bytes_pending_ -= end - covered->first;
+      covered->first = end;
     }
-  }
+    pending_.erase(pending_.begin(), covered);
 
-  // Check the segment(s) after this new segment
-  while (it != buffer_.end() && it->first <= last_index) {
-    const uint64_t cur_first_index = it->first;
-    const string& cur_data = it->second;
-    if (cur_first_index + cur_data.size() - 1 <= last_index) {
-      // The current segment is covered by the new segment
-      num_bytes_pending_ -= cur_data.size();
-    } else {
-      // Split the current segment and remove overlapping bytes
-      const uint64_t new_index = last_index + 1;
-      const uint64_t overlapping_bytes = new_index - cur_first_index;
-      buffer_[new_index] = cur_data.substr(overlapping_bytes);
-      num_bytes_pending_ -= overlapping_bytes;
-    }
-    it = buffer_.erase(it);
+    first_unassembled_index_ = end;
+    fast_path_inserts_++;
+    output.push(std::move(data));
+    // The segment may have closed the gap before the buffered bytes
+    flush(output);
+    try_close_stream(output);
+    return;
   }
 
-  buffer_[first_index] = data;
-  num_bytes_pending_ += data.size();
+  slow_path_inserts_++;
+  string_view bytes {data};
 
-  while (!buffer_.empty() && buffer_.begin()->first == first_unassembled_index_) {
-    auto& [_, bytes] = *buffer_.begin();
-    num_bytes_pending_ -= bytes.size();
-    first_unassembled_index_ += bytes.size();
-    output.push(std::move(bytes));
-    buffer_.erase(buffer_.begin());
+  // Trim bytes that can't fit in the assembler's storage
+  if (first_index + bytes.size() > first_unacceptable_index) {
+    bytes = bytes.substr(0, first_unacceptable_index - first_index);
   }
 
+  // The segment starts beyond the next needed byte, so it can only be stored for now
+  reserve(available_capacity);
+  store(first_index, bytes);
+
   try_close_stream(output);
 }
 
@@ -107,3 +82,70 @@ void Reassembler::try_close_stream(Writer& output) const
     output.close();
   }
 }
+
+void Reassembler::store(uint64_t first_index, string_view data)
+{
+  // Copy the bytes, wrapping around the end of the ring if needed
+  const uint64_t offset = first_index % ring_.size();
+  const uint64_t first_part = min<uint64_t>(data.size(), ring_.size() - offset);
+  data.copy(ring_.data() + offset, first_part);
+  data.copy(ring_.data(), data.size() - first_part, first_part);
+
+  // Merge [begin, end) with every range it overlaps or touches
+  uint64_t begin = first_index;
+  uint64_t end = first_index + data.size();
+  auto first = lower_bound(
+    pending_.begin(), pending_.end(), begin, [](const auto& range, uint64_t index) {
+      return range.second < index;
+    });
+  auto last = first;
+  while (last != pending_.end() && last->first <= end) {
+    begin = min(begin, last->first);
+    end = max(end, last->second);
+    num_bytes_pending_ -= last->second - last->first;
+    ++last;
+  }
+  num_bytes_pending_ += end - begin;
+
+  if (first == last) {
+    pending_.emplace(first, begin, end);
+  } else {
+    *first = {begin, end};
+    pending_.erase(first + 1, last);
+  }
+}
+
+void Reassembler::reserve(uint64_t window_size)
+{
+  if (window_size <= ring_.size()) {
+    return;
+  }
+
+  // Move the stored ranges to their positions in the larger ring
+  string old_ring = std::exchange(ring_, string(window_size, '\0'));
+  for (const auto& [begin, end] : pending_) {
+    for (uint64_t i = begin; i < end; i++) {
+      ring_[i % ring_.size()] = old_ring[i % old_ring.size()];
+    }
+  }
+}
+
+void Reassembler::flush(Writer& output)
+{
+  if (pending_.empty() || pending_.front().first != first_unassembled_index_) {
+    return;
+  }
+
+  const auto [begin, end] = pending_.front();
+  const uint64_t offset = begin % ring_.size();
+  const uint64_t first_part = min(end - begin, ring_.size() - offset);
+  string bytes;
+  bytes.reserve(end - begin);
+  bytes.append(ring_, offset, first_part);
+  bytes.append(ring_, 0, end - begin - first_part);
+
+  pending_.erase(pending_.begin());
+  num_bytes_pending_ -= end - begin;
+  first_unassembled_index_ = end;
+  output.push(std::move(bytes));
+}
@@ -2,9 +2,11 @@
 
 #include "byte_stream.hh"
 
-#include <map>
+#include <cstdint>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 class Reassembler
 {
@@ -34,11 +36,35 @@ public:
   // How many bytes are stored in the Reassembler itself?
   uint64_t bytes_pending() const;
 
+  // The [begin, end) stream index ranges stored in the Reassembler, in increasing order
+  const std::vector<std::pair<uint64_t, uint64_t>>& buffered_ranges() const { return pending_; }
+
+  // How many inserts were written straight to the output (they carried the next needed byte),
+  // and how many had to go through the Reassembler's own storage?
+  uint64_t fast_path_inserts() const { return fast_path_inserts_; }
+  uint64_t slow_path_inserts() const { return slow_path_inserts_; }
+
 private:
   void try_close_stream(Writer& output) const;
 
+  // Copy `data` into the ring and record its range as present
+  void store(uint64_t first_index, std::string_view data);
+
+  // Grow the ring so it can hold a window of `window_size` bytes
+  void reserve(uint64_t window_size);
+
+  // Write the bytes at the front of the ring to the output, as far as they are contiguous
+  void flush(Writer& output);
+
   uint64_t first_unassembled_index_ {};
-  std::map<uint64_t, std::string> buffer_ {};
+  // Out-of-order bytes live in `ring_` at (stream index % ring_.size()). The ring is as large as
+  // the largest window seen, so all storable bytes fit without colliding, and it is only
+  // reallocated when the window grows.
+  std::string ring_ {};
+  // Sorted, disjoint, non-adjacent [begin, end) stream index ranges present in the ring
+  std::vector<std::pair<uint64_t, uint64_t>> pending_ {};
   bool eof_ {};
   uint64_t num_bytes_pending_ {};
+  uint64_t fast_path_inserts_ {};
+  uint64_t slow_path_inserts_ {};
 };
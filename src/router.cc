@@ -1,12 +1,16 @@
 #include "router.hh"
 
 #include "address.hh"
+#include "checksum.hh"
 #include "ipv4_datagram.hh"
 
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
@@ -47,6 +51,19 @@ void Router::add_route(const uint32_t route_prefix,
   forwarding_table_.emplace_back(route_prefix, prefix_length, next_hop, interface_num);
 }
 
+const Router::Entry* Router::lookup(const uint32_t dst) const
+{
+  const Entry* matched_entry = nullptr;
+  // Perform longest prefix matching on the forwarding table
+  for (const auto& entry : forwarding_table_) {
+    if (match(entry.route_prefix, dst, entry.prefix_length)
+        && (matched_entry == nullptr || entry.prefix_length > matched_entry->prefix_length)) {
+      matched_entry = &entry;
+    }
+  }
+  return matched_entry;
+}
+
 void Router::route()
 {
   for (auto& network_interface : interfaces_) {
@@ -56,26 +73,92 @@ void Router::route()
       if (dgram.header.ttl <= 1) {
         continue;
       }
-      dgram.header.ttl--;
-      optional<Entry> matched_entry_opt;
-      // Perform longest prefix matching on the forwarding table
-      for (const auto& entry : forwarding_table_) {
-        if (match(entry.route_prefix, dgram.header.dst, entry.prefix_length)
-            && (!matched_entry_opt.has_value()
-                || entry.prefix_length > matched_entry_opt.value().prefix_length)) {
-          matched_entry_opt = entry;
-        }
-      }
-      if (!matched_entry_opt.has_value()) {
+      // Decrement the datagram's `ttl` field, updating the checksum incrementally
+      dgram.header.set_ttl(dgram.header.ttl - 1);
+      const Entry* matched_entry = lookup(dgram.header.dst);
+      if (matched_entry == nullptr) {
         continue;
       }
-      const Entry& matched_entry = matched_entry_opt.value();
-      // Recompute checksum since we decrement the datagram's `ttl` field
-      dgram.header.compute_checksum();
-      const Address next_hop = matched_entry.next_hop.has_value()
-                                 ? matched_entry.next_hop.value()
+      const Address next_hop = matched_entry->next_hop.has_value()
+                                 ? matched_entry->next_hop.value()
                                  : Address::from_ipv4_numeric(dgram.header.dst);
-      interface(matched_entry.interface_num).send_datagram(dgram, next_hop);
+      interface(matched_entry->interface_num).send_datagram(dgram, next_hop);
     }
   }
 }
+
+// Byte offsets of the fields the fast path reads, in an IPv4 header without options
+static constexpr size_t TTLOffset = 8;
+static constexpr size_t ChecksumOffset = 10;
+static constexpr size_t DestinationOffset = 16;
+
+bool Router::forward_in_place(vector<Buffer>& dgram)
+{
+  if (dgram.empty() || dgram.front().size() < IPv4Header::LENGTH) {
+    return false;
+  }
+  const string_view header = dgram.front();
+  const auto byte = [&header](size_t offset) { return static_cast<uint8_t>(header[offset]); };
+
+  // Version 4 with a 20-byte header, and a checksum that verifies
+  if (byte(0) != 0x45) {
+    return false;
+  }
+  InternetChecksum check;
+  check.add(header.substr(0, IPv4Header::LENGTH));
+  if (check.value() != 0) {
+    return false;
+  }
+
+  const uint8_t ttl = byte(TTLOffset);
+  if (ttl <= 1) {
+    return true; // dropped, as route() would
+  }
+  uint32_t dst = 0;
+  for (size_t i = 0; i < 4; i++) {
+    dst = (dst << 8) | byte(DestinationOffset + i);
+  }
+  const Entry* matched_entry = lookup(dst);
+  if (matched_entry == nullptr) {
+    return true;
+  }
+
+  // Decrement the TTL and update the checksum incrementally (RFC 1624)
+  const uint8_t proto = byte(TTLOffset + 1);
+  const uint16_t old_checksum = (byte(ChecksumOffset) << 8) | byte(ChecksumOffset + 1);
+  const uint16_t checksum = InternetChecksum::update(
+    old_checksum, (ttl << 8) | proto, ((ttl - 1) << 8) | proto);
+
+  // The frame's buffers may be shared with another holder of the frame, so unless this datagram is
+  // their only owner, patch a private copy of the header (copying the rest of its buffer as well)
+  if (!dgram.front().sole_owner()) {
+    Buffer patched {string {header.substr(0, IPv4Header::LENGTH)}};
+    Buffer rest {string {header.substr(IPv4Header::LENGTH)}};
+    dgram.front() = std::move(patched);
+    if (!rest.empty()) {
+      dgram.insert(dgram.begin() + 1, std::move(rest));
+    }
+  }
+  string& patched = dgram.front();
+  patched[TTLOffset] = static_cast<char>(ttl - 1);
+  patched[ChecksumOffset] = static_cast<char>(checksum >> 8);
+  patched[ChecksumOffset + 1] = static_cast<char>(checksum);
+
+  const Address next_hop = matched_entry->next_hop.has_value()
+                             ? matched_entry->next_hop.value()
+                             : Address::from_ipv4_numeric(dst);
+  interface(matched_entry->interface_num).send_serialized_datagram(std::move(dgram), next_hop);
+  return true;
+}
+
+void Router::recv_frame(const size_t interface_num, EthernetFrame&& frame)
+{
+  AsyncNetworkInterface& network_interface = interface(interface_num);
+  if (frame.header.dst == network_interface.ethernet_address()
+      && frame.header.type == EthernetHeader::TYPE_IPv4 && forward_in_place(frame.payload)) {
+    return;
+  }
+
+  network_interface.recv_frame(frame);
+  route();
+}
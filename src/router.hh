@@ -4,6 +4,7 @@
 
 #include <optional>
 #include <queue>
+#include <vector>
 
 // A wrapper for NetworkInterface that makes the host-side
 // interface asynchronous: instead of returning received datagrams
@@ -67,6 +68,13 @@ class Router
   // The forwarding table of this router
   std::vector<Entry> forwarding_table_ {};
 
+  // The route with the longest prefix that matches `dst`, or nullptr if none does
+  const Entry* lookup(uint32_t dst) const;
+
+  // Forward a datagram given as the payload of a received frame without parsing it, if it is an
+  // ordinary one (no options, valid header checksum). Returns false if it needs the slow path.
+  bool forward_in_place(std::vector<Buffer>& dgram);
+
 public:
   // Add an interface to the router
   // interface: an already-constructed network interface
@@ -93,4 +101,11 @@ public:
   // route with the longest prefix_length that matches the datagram's
   // destination address.
   void route();
+
+  // Receive a frame on interface `interface_num` and forward what it carries at once. Ordinary
+  // IPv4 datagrams take a fast path that reads the TTL and destination at fixed offsets, patches
+  // the TTL and checksum in the frame's own buffer, and hands that buffer to the outbound
+  // interface under a new Ethernet header. Everything else (ARP, IP options, bad checksums) goes
+  // through the interface's recv_frame() and route().
+  void recv_frame(size_t interface_num, EthernetFrame&& frame);
 };
@@ -5,6 +5,7 @@
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 
+#include <algorithm>
 #include <cstdint>
 
 using namespace std;
@@ -34,11 +35,9 @@ void TCPReceiver::receive(TCPSenderMessage message,
 TCPReceiverMessage TCPReceiver::send(const Writer& inbound_stream) const
 {
   TCPReceiverMessage recv_msg {};
-  // Window size is limited to 65,535 (UINT16_MAX)
-  const uint16_t window_size = (inbound_stream.available_capacity() > UINT16_MAX)
-                                 ? UINT16_MAX
-                                 : inbound_stream.available_capacity();
-  recv_msg.window_size = window_size;
+  // Window size is limited to what the window scale option can express
+  recv_msg.window_size = static_cast<uint32_t>(
+    min<uint64_t>(inbound_stream.available_capacity(), TCPReceiverMessage::MAX_WINDOW_SIZE));
 
   if (!receive_SYN_) {
     return recv_msg;
@@ -54,3 +53,22 @@ TCPReceiverMessage TCPReceiver::send(const Writer& inbound_stream) const
 
   return recv_msg;
 }
+
+TCPReceiverMessage TCPReceiver::send(const Writer& inbound_stream,
+                                     const Reassembler& reassembler) const
+{
+  TCPReceiverMessage recv_msg = send(inbound_stream);
+  if (!receive_SYN_) {
+    return recv_msg;
+  }
+
+  // Stream index i has absolute sequence number i + 1 (after the SYN)
+  const auto& ranges = reassembler.buffered_ranges();
+  const size_t num_blocks = min(ranges.size(), TCPReceiverMessage::MAX_SACK_BLOCKS);
+  for (size_t i = 0; i < num_blocks; i++) {
+    recv_msg.sack_blocks.emplace_back(Wrap32::wrap(ranges[i].first + 1, isn_),
+                                      Wrap32::wrap(ranges[i].second + 1, isn_));
+  }
+
+  return recv_msg;
+}
@@ -19,4 +19,7 @@ public:
 
   /* The TCPReceiver sends TCPReceiverMessages back to the TCPSender. */
   TCPReceiverMessage send(const Writer& inbound_stream) const;
+
+  /* As above, also reporting the Reassembler's buffered ranges as SACK blocks. */
+  TCPReceiverMessage send(const Writer& inbound_stream, const Reassembler& reassembler) const;
 };
@@ -14,6 +14,7 @@
 #include <random>
 #include <string>
 #include <utility>
+#include <vector>
 
 using namespace std;
 
@@ -51,9 +52,21 @@ bool CountdownTimer::running() const
   return state_ == State::RUNNING;
 }
 
+uint64_t CountdownTimer::remaining_ms() const
+{
+  return ms_;
+}
+
 /* TCPSender constructor (uses a random ISN if none given) */
-TCPSender::TCPSender(uint64_t initial_RTO_ms, optional<Wrap32> fixed_isn)
-  : isn_(fixed_isn.value_or(Wrap32 {random_device()()})), initial_RTO_ms_(initial_RTO_ms)
+TCPSender::TCPSender(uint64_t initial_RTO_ms,
+                     optional<Wrap32> fixed_isn,
+                     CongestionControlAlgorithm congestion_control,
+                     optional<RTOBounds> rto_bounds)
+  : isn_(fixed_isn.value_or(Wrap32 {random_device()()}))
+  , initial_RTO_ms_(initial_RTO_ms)
+  , rto_bounds_(rto_bounds)
+  , congestion_control_(
+      CongestionControl::make(congestion_control, TCPConfig::MAX_PAYLOAD_SIZE))
 {}
 
 uint64_t TCPSender::sequence_numbers_in_flight() const
@@ -66,22 +79,93 @@ uint64_t TCPSender::consecutive_retransmissions() const
   return consecutive_retransmission_count_;
 }
 
+uint64_t TCPSender::segments_presumed_lost() const
+{
+  return lost_count_;
+}
+
+uint64_t TCPSender::duplicate_acks() const
+{
+  return duplicate_ack_count_;
+}
+
+bool TCPSender::in_fast_recovery() const
+{
+  return in_fast_recovery_;
+}
+
+uint64_t TCPSender::congestion_window() const
+{
+  return congestion_control_->cwnd();
+}
+
+uint64_t TCPSender::mss() const
+{
+  return mss_;
+}
+
+void TCPSender::set_mss(uint64_t mss)
+{
+  mss_ = mss;
+  congestion_control_->set_mss(mss);
+}
+
+void TCPSender::set_nagle(bool enabled)
+{
+  nagle_ = enabled;
+}
+
+void TCPSender::set_corked(bool corked)
+{
+  corked_ = corked;
+}
+
+void TCPSender::set_max_hold_ms(uint64_t max_hold_ms)
+{
+  max_hold_ms_ = max_hold_ms;
+}
+
+uint64_t TCPSender::smoothed_rtt_ms() const
+{
+  return srtt_ms_;
+}
+
+uint64_t TCPSender::current_RTO_ms() const
+{
+  return RTO_ms_;
+}
+
 optional<TCPSenderMessage> TCPSender::maybe_send()
 {
-  // If the timer expires, send the earliest outstanding segment first
+  // If the timer expires, send the earliest segment the receiver is missing first
   if (timer_.expired()) {
     // Precondition: when the timer expires, collection of
     // outstanding messages must be nonempty
     timer_.start(RTO_ms_);
-    return optional<TCPSenderMessage> {outstanding_msgs_.front()};
+    OutstandingSegment& seg = first_unsacked();
+    if (seg.state == SegmentState::LOST) {
+      lost_count_--;
+    }
+    seg.state = SegmentState::RETRANSMITTED;
+    return optional<TCPSenderMessage> {seg.msg};
+  }
+
+  // Then fill the holes the receiver reported before sending new data
+  if (lost_count_ > 0) {
+    for (auto& seg : outstanding_msgs_) {
+      if (seg.state == SegmentState::LOST) {
+        lost_count_--;
+        seg.state = SegmentState::RETRANSMITTED;
+        return optional<TCPSenderMessage> {seg.msg};
+      }
+    }
   }
 
   if (msg_queue_.empty()) {
     return optional<TCPSenderMessage> {};
   }
 
-  TCPSenderMessage msg = msg_queue_.front();
-  if (!fit_in_window(msg)) {
+  if (!fit_in_window(msg_queue_.front())) {
     return optional<TCPSenderMessage> {};
   }
 
@@ -89,16 +173,26 @@ optional<TCPSenderMessage> TCPSender::maybe_send()
     timer_.start(RTO_ms_);
   }
 
+  // The outstanding copy shares the payload Buffer with the returned message
+  TCPSenderMessage msg = std::move(msg_queue_.front());
   msg_queue_.pop();
-  outstanding_msgs_.push(msg);
-  acknos_.insert(msg.seqno.unwrap(isn_, abs_seqno_) + msg.sequence_length());
+  const uint64_t msg_abs_seqno = msg.seqno.unwrap(isn_, abs_seqno_);
+  outstanding_msgs_.push_back({msg, msg_abs_seqno, SegmentState::SENT, time_ms_});
+  acknos_.insert(msg_abs_seqno + msg.sequence_length());
 
   return msg;
 }
 
+void TCPSender::maybe_send(vector<TCPSenderMessage>& out)
+{
+  while (auto msg = maybe_send()) {
+    out.push_back(std::move(msg.value()));
+  }
+}
+
 void TCPSender::push(Reader& outbound_stream)
 {
-  while (sequence_numbers_in_flight() < get_window_size()) {
+  while (sequence_numbers_in_flight() < effective_window()) {
     TCPSenderMessage msg;
     if (!send_SYN_) {
       send_SYN_ = true;
@@ -107,11 +201,12 @@ void TCPSender::push(Reader& outbound_stream)
 
     msg.seqno = Wrap32::wrap(abs_seqno_, isn_);
 
-    const uint64_t max_possible_segment_size = ackno_ + get_window_size() - abs_seqno_ - msg.SYN;
-    const uint64_t payload_size = min(TCPConfig::MAX_PAYLOAD_SIZE, max_possible_segment_size);
-    std::string payload {outbound_stream.peek().substr(0, payload_size)};
-    msg.payload = Buffer {std::move(payload)};
-    outbound_stream.pop(payload_size);
+    const uint64_t max_possible_segment_size = ackno_ + effective_window() - abs_seqno_ - msg.SYN;
+    const uint64_t payload_size = min(mss_, max_possible_segment_size);
+    if (!msg.SYN && hold_back(outbound_stream, payload_size)) {
+      break;
+    }
+    msg.payload = outbound_stream.pop_buffer(payload_size);
 
     if (!receive_FIN_ && outbound_stream.is_finished()
         && msg.payload.length() < max_possible_segment_size) {
@@ -129,6 +224,45 @@ void TCPSender::push(Reader& outbound_stream)
   }
 }
 
+bool TCPSender::hold_back(const Reader& outbound_stream, uint64_t payload_size)
+{
+  // Only a segment that is short for lack of data is held back: a full segment, one limited by
+  // the window, or the end of the stream goes out right away
+  const uint64_t buffered = outbound_stream.bytes_buffered();
+  const bool short_segment
+    = buffered > 0 && buffered < payload_size && !outbound_stream.writer().is_closed();
+  // Nagle's algorithm waits only while earlier data is unacknowledged; a cork always waits
+  const bool wait = corked_ || (nagle_ && sequence_numbers_in_flight() > 0);
+  if (!short_segment || !wait) {
+    holding_ = false;
+    return false;
+  }
+
+  if (!holding_) {
+    holding_ = true;
+    hold_start_ms_ = time_ms_;
+  }
+  if (time_ms_ - hold_start_ms_ >= max_hold_ms_) {
+    holding_ = false;
+    return false;
+  }
+  return true;
+}
+
+optional<uint64_t> TCPSender::ms_until_next_timer() const
+{
+  optional<uint64_t> next;
+  if (timer_.running()) {
+    next = timer_.remaining_ms();
+  }
+  if (holding_) {
+    const uint64_t held_ms = time_ms_ - hold_start_ms_;
+    const uint64_t left_ms = held_ms >= max_hold_ms_ ? 0 : max_hold_ms_ - held_ms;
+    next = min(next.value_or(left_ms), left_ms);
+  }
+  return next;
+}
+
 TCPSenderMessage TCPSender::send_empty_message() const
 {
   TCPSenderMessage msg;
@@ -136,26 +270,78 @@ TCPSenderMessage TCPSender::send_empty_message() const
   return msg;
 }
 
-void TCPSender::receive(const TCPReceiverMessage& msg)
+void TCPSender::receive(const TCPReceiverMessage& msg, bool pure_ack)
 {
+  const uint32_t previous_window_size = window_size_;
   window_size_ = msg.window_size;
+  uint64_t bytes_acked = 0;
   if (msg.ackno.has_value()) {
     // the ackno reflects an absolute sequence number bigger than
     // any previous ackno
     const uint64_t new_ackno = msg.ackno.value().unwrap(isn_, abs_seqno_);
+    // A duplicate ackno acknowledges nothing new, but may carry SACK blocks.
+    // It only counts towards fast retransmit if the window is unchanged
+    // (otherwise it is a window update) and nothing else came with it.
+    if (new_ackno == ackno_ && !outstanding_msgs_.empty()) {
+      const bool recovering = in_fast_recovery_;
+      update_scoreboard(msg);
+      if (pure_ack && msg.window_size == previous_window_size) {
+        on_duplicate_ack(recovering);
+      }
+      return;
+    }
     // Invalid ackno
     if (!acknos_.contains(new_ackno)) {
       return;
     }
     acknos_.erase(new_ackno);
+    // The SYN is not data, so it does not open the congestion window
+    bytes_acked = new_ackno - max<uint64_t>(ackno_, 1);
+    if (bytes_acked > 0 && !in_fast_recovery_) {
+      congestion_control_->on_ack(bytes_acked, time_ms_);
+    }
     ackno_ = new_ackno;
-    RTO_ms_ = initial_RTO_ms_;
     consecutive_retransmission_count_ = 0;
+    duplicate_ack_count_ = 0;
+  }
+
+  // Karn's rule: only segments that were never retransmitted give an unambiguous RTT,
+  // and the most recently sent of them gives the freshest one
+  optional<uint64_t> rtt_sample;
+  while (!outstanding_msgs_.empty() && outstanding_msgs_.front().abs_seqno < ackno_) {
+    const OutstandingSegment& seg = outstanding_msgs_.front();
+    if (seg.state == SegmentState::LOST) {
+      lost_count_--;
+    }
+    if (seg.state == SegmentState::SENT || seg.state == SegmentState::LOST) {
+      rtt_sample = time_ms_ - seg.sent_ms;
+    }
+    outstanding_msgs_.pop_front();
   }
+  if (msg.ackno.has_value()) {
+    if (rtt_sample.has_value() && rto_bounds_.has_value()) {
+      update_rtt(rtt_sample.value());
+    }
+    RTO_ms_ = estimated_RTO_ms_;
+  }
+  const bool recovering = in_fast_recovery_;
+  update_scoreboard(msg);
 
-  while (!outstanding_msgs_.empty()
-         && outstanding_msgs_.front().seqno.unwrap(isn_, abs_seqno_) < ackno_) {
-    outstanding_msgs_.pop();
+  // A partial ACK during fast recovery means the next hole is lost as well,
+  // so retransmit it right away instead of waiting for more duplicates
+  if (in_fast_recovery_) {
+    if (ackno_ >= recover_ || outstanding_msgs_.empty()) {
+      in_fast_recovery_ = false;
+      congestion_control_->on_recovery_end();
+    } else {
+      // A window that recovery only just began with (on this ACK's SACK blocks) is not deflated
+      if (recovering) {
+        congestion_control_->on_partial_ack(bytes_acked);
+      }
+      if (outstanding_msgs_.front().state == SegmentState::SENT) {
+        mark_lost(outstanding_msgs_.front());
+      }
+    }
   }
 
   // If there are outstanding segments, restart the timer with
@@ -169,12 +355,22 @@ void TCPSender::receive(const TCPReceiverMessage& msg)
 
 void TCPSender::tick(const size_t ms_since_last_tick)
 {
+  time_ms_ += ms_since_last_tick;
   timer_.tick(ms_since_last_tick);
   // Double RTO for the earliest segment that hasn't
   // been acknowledged by the receiver
   if (timer_.expired() && window_size_ != 0) {
     consecutive_retransmission_count_++;
     RTO_ms_ *= 2;
+    if (rto_bounds_.has_value()) {
+      RTO_ms_ = min(RTO_ms_, rto_bounds_->max_ms);
+    }
+    congestion_control_->on_rto(sequence_numbers_in_flight(), time_ms_);
+  }
+  // A timeout ends fast recovery; the duplicate count starts over
+  if (timer_.expired()) {
+    in_fast_recovery_ = false;
+    duplicate_ack_count_ = 0;
   }
 }
 
@@ -183,5 +379,104 @@ bool TCPSender::fit_in_window(const TCPSenderMessage& msg) const
   const Wrap32 last_seqno = msg.seqno + msg.sequence_length();
   // When the window size is zero, this method pretends like
   // the window size is 1
-  return last_seqno.unwrap(isn_, abs_seqno_) <= ackno_ + get_window_size();
+  return last_seqno.unwrap(isn_, abs_seqno_) <= ackno_ + effective_window();
+}
+
+void TCPSender::update_scoreboard(const TCPReceiverMessage& msg)
+{
+  if (msg.sack_blocks.empty() || outstanding_msgs_.empty()) {
+    return;
+  }
+
+  for (const auto& [left, right] : msg.sack_blocks) {
+    const uint64_t begin = left.unwrap(isn_, abs_seqno_);
+    const uint64_t end = right.unwrap(isn_, abs_seqno_);
+    // Find the first segment that starts inside the block
+    auto it = lower_bound(
+      outstanding_msgs_.begin(), outstanding_msgs_.end(), begin,
+      [](const OutstandingSegment& seg, uint64_t seqno) { return seg.abs_seqno < seqno; });
+    for (; it != outstanding_msgs_.end() && it->abs_end() <= end; ++it) {
+      if (it->state == SegmentState::LOST) {
+        lost_count_--;
+      }
+      it->state = SegmentState::SACKED;
+    }
+  }
+
+  // A segment that has not been SACKed is presumed lost once DUP_THRESH
+  // segments above it have been SACKed; walk from the top down to count them
+  uint64_t sacked_above = 0;
+  for (auto it = outstanding_msgs_.rbegin(); it != outstanding_msgs_.rend(); ++it) {
+    if (it->state == SegmentState::SACKED) {
+      sacked_above++;
+    } else if (it->state == SegmentState::SENT && sacked_above >= DUP_THRESH) {
+      mark_lost(*it);
+    }
+  }
+  if (lost_count_ > 0 && !in_fast_recovery_) {
+    enter_fast_recovery();
+  }
+}
+
+OutstandingSegment& TCPSender::first_unsacked()
+{
+  for (auto& seg : outstanding_msgs_) {
+    if (seg.state != SegmentState::SACKED) {
+      return seg;
+    }
+  }
+  // The receiver may discard data it has SACKed, so fall back to the earliest segment
+  return outstanding_msgs_.front();
+}
+
+void TCPSender::mark_lost(OutstandingSegment& seg)
+{
+  if (seg.state != SegmentState::LOST) {
+    seg.state = SegmentState::LOST;
+    lost_count_++;
+  }
+}
+
+void TCPSender::on_duplicate_ack(bool recovering)
+{
+  duplicate_ack_count_++;
+  if (recovering) {
+    congestion_control_->on_recovery_dup_ack();
+    return;
+  }
+  if (duplicate_ack_count_ != DUP_THRESH || in_fast_recovery_) {
+    return;
+  }
+
+  // Fast retransmit: resend the first missing segment now, without backing off the RTO
+  enter_fast_recovery();
+  OutstandingSegment& seg = first_unsacked();
+  if (seg.state != SegmentState::SACKED) {
+    mark_lost(seg);
+  }
+}
+
+void TCPSender::enter_fast_recovery()
+{
+  in_fast_recovery_ = true;
+  recover_ = outstanding_msgs_.back().abs_end();
+  congestion_control_->on_loss(sequence_numbers_in_flight(), time_ms_);
+}
+
+void TCPSender::update_rtt(uint64_t rtt_ms)
+{
+  if (!have_rtt_sample_) {
+    have_rtt_sample_ = true;
+    srtt_ms_ = rtt_ms;
+    rttvar_ms_ = rtt_ms / 2;
+  } else {
+    // RTTVAR <- 3/4 RTTVAR + 1/4 |SRTT - R'|, then SRTT <- 7/8 SRTT + 1/8 R'
+    const uint64_t deviation = srtt_ms_ > rtt_ms ? srtt_ms_ - rtt_ms : rtt_ms - srtt_ms_;
+    rttvar_ms_ = (3 * rttvar_ms_ + deviation) / 4;
+    srtt_ms_ = (7 * srtt_ms_ + rtt_ms) / 8;
+  }
+
+  // RTO <- SRTT + max(G, 4 RTTVAR), where the clock granularity G is one tick of 1 ms
+  const uint64_t rto = srtt_ms_ + max<uint64_t>(1, 4 * rttvar_ms_);
+  estimated_RTO_ms_ = clamp(rto, rto_bounds_->min_ms, rto_bounds_->max_ms);
 }
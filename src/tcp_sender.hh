@@ -1,11 +1,17 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include "congestion_control.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 
+#include <algorithm>
+#include <deque>
+#include <memory>
 #include <queue>
 #include <unordered_set>
+#include <vector>
 
 enum class State
 {
@@ -37,40 +43,149 @@ public:
 
   /* Is the timer running */
   bool running() const;
+
+  /* Milliseconds left before a running timer expires */
+  uint64_t remaining_ms() const;
+};
+
+/* Scoreboard state of an outstanding segment */
+enum class SegmentState
+{
+  SENT,          // sent once, neither acknowledged nor selectively acknowledged
+  SACKED,        // covered by a SACK block from the receiver
+  LOST,          // presumed lost because enough later segments were SACKed
+  RETRANSMITTED, // resent after being marked lost or after the timer expired
+};
+
+struct OutstandingSegment
+{
+  TCPSenderMessage msg {};
+  uint64_t abs_seqno {}; // absolute sequence number of the first byte of the segment
+  SegmentState state {SegmentState::SENT};
+  uint64_t sent_ms {}; // when the segment was first sent
+
+  uint64_t abs_end() const { return abs_seqno + msg.sequence_length(); }
+};
+
+/* Bounds of the adaptive retransmission timeout (RFC 6298) */
+struct RTOBounds
+{
+  uint64_t min_ms {};
+  uint64_t max_ms {};
 };
 
 class TCPSender
 {
 private:
+  // a segment is presumed lost once this many later segments have been SACKed (RFC 6675)
+  static constexpr uint64_t DUP_THRESH = 3;
+
   Wrap32 isn_ {0};
 
   uint64_t initial_RTO_ms_ {};
   uint64_t RTO_ms_ {initial_RTO_ms_};
   CountdownTimer timer_ {};
+  // milliseconds since the sender was created
+  uint64_t time_ms_ {};
+
+  // RTT estimation (RFC 6298); without bounds the RTO stays at its initial value
+  std::optional<RTOBounds> rto_bounds_;
+  bool have_rtt_sample_ {};
+  uint64_t srtt_ms_ {};
+  uint64_t rttvar_ms_ {};
+  // RTO that a new ACK restores after any exponential back-off
+  uint64_t estimated_RTO_ms_ {initial_RTO_ms_};
+
+  std::unique_ptr<CongestionControl> congestion_control_;
 
   bool send_SYN_ {};
   bool receive_FIN_ {};
 
+  // largest payload to put in a segment
+  uint64_t mss_ {TCPConfig::MAX_PAYLOAD_SIZE};
+
+  // segment coalescing: Nagle's algorithm and corking hold back short segments,
+  // but never for longer than max_hold_ms_
+  bool nagle_ {};
+  bool corked_ {};
+  uint64_t max_hold_ms_ {TCPConfig::MAX_HOLD_DFLT};
+  bool holding_ {};
+  uint64_t hold_start_ms_ {};
+
   uint64_t abs_seqno_ {};
   uint64_t ackno_ {};
   std::unordered_set<uint64_t> acknos_ {};
-  uint16_t window_size_ {1};
+  uint32_t window_size_ {1};
 
   uint64_t consecutive_retransmission_count_ {};
 
+  // duplicate ACKs received since the ackno last advanced
+  uint64_t duplicate_ack_count_ {};
+  // fast recovery (RFC 6582) lasts until everything sent before it began
+  // (up to recover_) is acknowledged
+  bool in_fast_recovery_ {};
+  uint64_t recover_ {};
+
   // queue of buffered (unsent) messages (segments)
   std::queue<TCPSenderMessage> msg_queue_ {};
-  // queue of outstanding messages (segments), which are pushed
-  // pushed into the queue in an increasing order
-  std::queue<TCPSenderMessage> outstanding_msgs_ {};
-
-  uint16_t get_window_size() const { return window_size_ ? window_size_ : 1; }
+  // scoreboard of outstanding messages (segments), kept in increasing
+  // order of sequence number
+  std::deque<OutstandingSegment> outstanding_msgs_ {};
+  // number of outstanding segments in the LOST state
+  uint64_t lost_count_ {};
 
   bool fit_in_window(const TCPSenderMessage& msg) const;
 
+  /* Mark segments covered by the SACK blocks of msg, then presume losses */
+  void update_scoreboard(const TCPReceiverMessage& msg);
+
+  /* The earliest outstanding segment the receiver has not SACKed */
+  OutstandingSegment& first_unsacked();
+
+  /* Mark a segment for retransmission by the next maybe_send() */
+  void mark_lost(OutstandingSegment& seg);
+
+  /* Count a duplicate ACK and fast-retransmit on the DUP_THRESH-th one; if fast recovery was
+   * already under way, inflate the congestion window instead */
+  void on_duplicate_ack(bool recovering);
+
+  /* Enter fast recovery and let the congestion controller react to the loss */
+  void enter_fast_recovery();
+
+  /* Should push() wait for more data instead of sending a `payload_size` segment now? */
+  bool hold_back(const Reader& outbound_stream, uint64_t payload_size);
+
+  /* Fold a round-trip time measurement into SRTT, RTTVAR and the RTO */
+  void update_rtt(uint64_t rtt_ms);
+
+  uint32_t get_window_size() const { return window_size_ ? window_size_ : 1; }
+
+  // The sender may have the smaller of the receiver's and the congestion window in flight
+  uint64_t effective_window() const
+  {
+    return std::min<uint64_t>(get_window_size(), congestion_control_->cwnd());
+  }
+
 public:
-  /* Construct TCP sender with given default Retransmission Timeout and possible ISN */
-  TCPSender(uint64_t initial_RTO_ms, std::optional<Wrap32> fixed_isn);
+  /* Construct TCP sender with given default Retransmission Timeout, possible ISN,
+   * congestion control algorithm and bounds for an adaptive RTO (fixed RTO if none given) */
+  TCPSender(uint64_t initial_RTO_ms,
+            std::optional<Wrap32> fixed_isn,
+            CongestionControlAlgorithm congestion_control = CongestionControlAlgorithm::NONE,
+            std::optional<RTOBounds> rto_bounds = {});
+
+  /* Use segments of at most `mss` payload bytes, as agreed with the peer during the handshake */
+  void set_mss(uint64_t mss);
+
+  /* Hold back segments shorter than the MSS while earlier data is unacknowledged (Nagle's
+   * algorithm) */
+  void set_nagle(bool enabled);
+
+  /* While corked, hold back segments shorter than the MSS even with nothing in flight */
+  void set_corked(bool corked);
+
+  /* Longest time that Nagle's algorithm or a cork may hold data back */
+  void set_max_hold_ms(uint64_t max_hold_ms);
 
   /* Push bytes from the outbound stream */
   void push(Reader& outbound_stream);
@@ -78,18 +193,34 @@ public:
   /* Send a TCPSenderMessage if needed (or empty optional otherwise) */
   std::optional<TCPSenderMessage> maybe_send();
 
+  /* Append every TCPSenderMessage that can be sent now, retransmissions first, to `out`. Their
+   * payloads are shared with the outstanding copies, not copied. */
+  void maybe_send(std::vector<TCPSenderMessage>& out);
+
   /* Generate an empty TCPSenderMessage */
   TCPSenderMessage send_empty_message() const;
 
-  /* Receive an act on a TCPReceiverMessage from the peer's receiver */
-  void receive(const TCPReceiverMessage& msg);
+  /* Receive an act on a TCPReceiverMessage from the peer's receiver. `pure_ack` says the segment
+   * that carried it had no payload, SYN or FIN; only such ACKs count as duplicates (RFC 5681). */
+  void receive(const TCPReceiverMessage& msg, bool pure_ack = true);
 
   /* Time has passed by the given # of milliseconds since the last time the tick() method was
    * called. */
   void tick(uint64_t ms_since_last_tick);
 
+  /* Milliseconds until tick() next has work to do (the retransmission timer expires or a
+   * held-back segment must go out), or nothing if neither is pending */
+  std::optional<uint64_t> ms_until_next_timer() const;
+
   /* Accessors for use in testing */
   uint64_t sequence_numbers_in_flight() const; // How many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions()
     const; // How many consecutive *re*transmissions have happened?
+  uint64_t segments_presumed_lost() const; // How many segments await selective retransmission?
+  uint64_t duplicate_acks() const;         // How many duplicate ACKs since the ackno advanced?
+  bool in_fast_recovery() const;           // Is a fast retransmission being recovered from?
+  uint64_t congestion_window() const;      // How many sequence numbers may be in flight?
+  uint64_t mss() const;                    // What is the largest payload of a segment?
+  uint64_t smoothed_rtt_ms() const;        // What is the smoothed round-trip time (SRTT)?
+  uint64_t current_RTO_ms() const;         // What is the retransmission timeout right now?
 };
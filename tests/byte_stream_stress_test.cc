@@ -7,7 +7,8 @@ using namespace std;
 
 void stress_test(const size_t input_len,   // NOLINT(bugprone-easily-swappable-parameters)
                  const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t random_seed) // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
+                 const ByteStream::Storage storage = ByteStream::Storage::Ring)
 {
   default_random_engine rd {random_seed};
 
@@ -21,7 +22,9 @@ void stress_test(const size_t input_len,   // NOLINT(bugprone-easily-swappable-p
   }();
 
   ByteStreamTestHarness bs {
-    "stress test input=" + to_string(input_len) + ", capacity=" + to_string(capacity), capacity};
+    "stress test input=" + to_string(input_len) + ", capacity=" + to_string(capacity),
+    capacity,
+    storage};
 
   size_t expected_bytes_pushed {};
   size_t expected_bytes_popped {};
@@ -56,11 +59,22 @@ void stress_test(const size_t input_len,   // NOLINT(bugprone-easily-swappable-p
     }
 
     bs.execute(PeekOnce {data.substr(expected_bytes_popped, peek_size)});
+    bs.execute(
+      PeekIov {data.substr(expected_bytes_popped, expected_bytes_pushed - expected_bytes_popped)});
 
-    uniform_int_distribution<size_t> bytes_to_pop_dist {0, peek_size};
+    /* pop either from the peeked view, or across everything buffered (into Buffers, or one) */
+    const auto pop_kind = rd() % 3;
+    uniform_int_distribution<size_t> bytes_to_pop_dist {
+      0, pop_kind == 0 ? peek_size : expected_bytes_pushed - expected_bytes_popped};
     const size_t amount_to_pop = bytes_to_pop_dist(rd);
 
-    bs.execute(Pop {amount_to_pop});
+    if (pop_kind == 1) {
+      bs.execute(PopBuffers {data.substr(expected_bytes_popped, amount_to_pop)});
+    } else if (pop_kind == 2) {
+      bs.execute(PopBuffer {data.substr(expected_bytes_popped, amount_to_pop)});
+    } else {
+      bs.execute(Pop {amount_to_pop});
+    }
     expected_bytes_popped += amount_to_pop;
     expected_available_capacity += amount_to_pop;
     bs.execute(BytesPopped {expected_bytes_popped});
@@ -76,6 +90,10 @@ void program_body()
   stress_test(18, 17, 12345);
   stress_test(1111, 17, 98765);
   stress_test(4097, 4096, 11101);
+
+  stress_test(19, 3, 10110, ByteStream::Storage::Chunked);
+  stress_test(1111, 17, 98765, ByteStream::Storage::Chunked);
+  stress_test(4097, 4096, 11101, ByteStream::Storage::Chunked);
 }
 
 int main()
@@ -16,8 +16,13 @@ static_assert(sizeof(Writer) == sizeof(ByteStream),
 class ByteStreamTestHarness : public TestHarness<ByteStream>
 {
 public:
-  ByteStreamTestHarness(std::string test_name, uint64_t capacity)
-    : TestHarness(move(test_name), "capacity=" + std::to_string(capacity), ByteStream {capacity})
+  ByteStreamTestHarness(std::string test_name,
+                        uint64_t capacity,
+                        ByteStream::Storage storage = ByteStream::Storage::Ring)
+    : TestHarness(move(test_name),
+                  "capacity=" + std::to_string(capacity)
+                    + (storage == ByteStream::Storage::Chunked ? ", chunked" : ""),
+                  ByteStream {capacity, storage})
   {}
 
   size_t peek_size() { return object().reader().peek().size(); }
@@ -114,6 +119,82 @@ struct PeekOnce : public Peek
   }
 };
 
+struct PeekIov : public Peek
+{
+  using Peek::Peek;
+
+  std::string description() const override
+  {
+    return "peek_iov() gives \"" + Printer::prettify(output_) + "\"";
+  }
+
+  void execute(ByteStream& bs) const override
+  {
+    std::vector<std::string_view> views;
+    bs.reader().peek_iov(views);
+    std::string got;
+    for (const auto& view : views) {
+      if (view.empty()) {
+        throw ExpectationViolation {"Reader::peek_iov() returned an empty string_view"};
+      }
+      got += view;
+    }
+    if (got != output_) {
+      throw ExpectationViolation {"Expected \"" + Printer::prettify(output_) + "\" in buffer, "
+                                  + "but peek_iov() found \"" + Printer::prettify(got) + "\""};
+    }
+  }
+};
+
+struct PopBuffers : public Expectation<ByteStream>
+{
+  std::string output_;
+
+  explicit PopBuffers(std::string output) : output_(move(output)) {}
+
+  std::string description() const override
+  {
+    return "pop_buffers( " + std::to_string(output_.size()) + " ) gives \""
+           + Printer::prettify(output_) + "\"";
+  }
+
+  void execute(ByteStream& bs) const override
+  {
+    std::vector<Buffer> buffers;
+    bs.reader().pop_buffers(output_.size(), buffers);
+    std::string got;
+    for (const auto& buf : buffers) {
+      got += std::string_view {buf};
+    }
+    if (got != output_) {
+      throw ExpectationViolation {"Expected to pop \"" + Printer::prettify(output_)
+                                  + "\", but found \"" + Printer::prettify(got) + "\""};
+    }
+  }
+};
+
+struct PopBuffer : public Expectation<ByteStream>
+{
+  std::string output_;
+
+  explicit PopBuffer(std::string output) : output_(move(output)) {}
+
+  std::string description() const override
+  {
+    return "pop_buffer( " + std::to_string(output_.size()) + " ) gives \""
+           + Printer::prettify(output_) + "\"";
+  }
+
+  void execute(ByteStream& bs) const override
+  {
+    const Buffer buf = bs.reader().pop_buffer(output_.size());
+    if (std::string_view {buf} != output_) {
+      throw ExpectationViolation {"Expected to pop \"" + Printer::prettify(output_)
+                                  + "\", but found \"" + Printer::prettify(buf) + "\""};
+    }
+  }
+};
+
 struct IsClosed : public ExpectBool<ByteStream>
 {
   using ExpectBool::ExpectBool;
@@ -0,0 +1,295 @@
+#include "checksum.hh"
+#include "ipv4_header.hh"
+#include "random.hh"
+#include "test_should_be.hh"
+
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+using Kernel = InternetChecksum::Kernel;
+
+string kernel_name(const Kernel kernel)
+{
+  switch (kernel) {
+    case Kernel::BYTEWISE:
+      return "bytewise";
+    case Kernel::WORDS:
+      return "64-bit words";
+    case Kernel::SSE2:
+      return "SSE2";
+    case Kernel::AVX2:
+      return "AVX2";
+  }
+  return "unknown";
+}
+
+// Checksum of `pieces` added one after another, starting from `initial`
+uint16_t checksum(const Kernel kernel, const uint32_t initial, const vector<string_view>& pieces)
+{
+  InternetChecksum check {initial};
+  for (const auto& piece : pieces) {
+    check.add(piece, kernel);
+  }
+  return check.value();
+}
+
+// Every supported kernel must agree with the bytewise one on `pieces`, and so must the same bytes
+// added as one piece
+void expect_same(const uint32_t initial, const vector<string_view>& pieces, const string& what)
+{
+  string whole;
+  for (const auto& piece : pieces) {
+    whole += piece;
+  }
+  const uint16_t expected = checksum(Kernel::BYTEWISE, initial, {whole});
+
+  for (const Kernel kernel : {Kernel::BYTEWISE, Kernel::WORDS, Kernel::SSE2, Kernel::AVX2}) {
+    if (not InternetChecksum::supported(kernel)) {
+      continue;
+    }
+    if (checksum(kernel, initial, pieces) != expected) {
+      throw runtime_error("kernel " + kernel_name(kernel) + " computed a different checksum for "
+                          + what + " (" + to_string(whole.size()) + " bytes in "
+                          + to_string(pieces.size()) + " pieces)");
+    }
+  }
+}
+
+string random_bytes(default_random_engine& rd, const size_t size)
+{
+  uniform_int_distribution<char> byte_dist;
+  string ret;
+  for (size_t i = 0; i < size; i++) {
+    ret += byte_dist(rd);
+  }
+  return ret;
+}
+
+// Every length up to a few vector widths, starting at every offset within a vector
+void lengths_and_offsets(default_random_engine& rd)
+{
+  const string data = random_bytes(rd, 256 + 64);
+  for (size_t offset = 0; offset < 64; offset++) {
+    for (size_t length = 0; length <= 256; length++) {
+      expect_same(0, {string_view {data}.substr(offset, length)}, "offset " + to_string(offset));
+    }
+  }
+}
+
+// The same bytes split into pieces at odd and even lengths, as across the Buffers of a segment
+void splits(default_random_engine& rd)
+{
+  uniform_int_distribution<size_t> size_dist {0, 1500};
+  uniform_int_distribution<uint32_t> initial_dist {0, 0x3fffc}; // up to a pseudo-header's sum
+  for (unsigned int i = 0; i < 2000; i++) {
+    const string data = random_bytes(rd, size_dist(rd));
+    const string_view view {data};
+    uniform_int_distribution<size_t> split_dist {0, data.size()};
+    size_t first = split_dist(rd);
+    size_t second = split_dist(rd);
+    if (first > second) {
+      swap(first, second);
+    }
+    expect_same(initial_dist(rd),
+                {view.substr(0, first), view.substr(first, second - first), view.substr(second)},
+                "a split segment");
+  }
+}
+
+// Runs of all-ones and all-zero bytes, where the sums carry the most (or not at all)
+void extremes()
+{
+  for (const char byte : {'\xff', '\0'}) {
+    const string data(4096 + 3, byte);
+    const string_view view {data};
+    for (const uint32_t initial : {uint32_t {0}, uint32_t {0xffff}, uint32_t {0x3fffc}}) {
+      expect_same(initial, {view}, "a run of equal bytes");
+      expect_same(initial, {view.substr(0, 1), view.substr(1, 2047), view.substr(2048)},
+                  "a split run of equal bytes");
+    }
+  }
+}
+
+// add() over a list of Buffers covers the same bytes as over one string
+void buffers(default_random_engine& rd)
+{
+  const vector<Buffer> pieces {random_bytes(rd, 21), random_bytes(rd, 0), random_bytes(rd, 1000)};
+  InternetChecksum check;
+  check.add(pieces);
+
+  string whole;
+  for (const auto& piece : pieces) {
+    whole += string_view {piece};
+  }
+  test_should_be(check.value(), checksum(Kernel::BYTEWISE, 0, {whole}));
+}
+
+// Checksum of 16-bit words, as compute_checksum() sums a header
+uint16_t checksum(const vector<uint16_t>& words)
+{
+  string bytes;
+  for (const uint16_t word : words) {
+    bytes += static_cast<char>(word >> 8);
+    bytes += static_cast<char>(word);
+  }
+  InternetChecksum check;
+  check.add(bytes);
+  return check.value();
+}
+
+// Changing one word and updating the checksum (RFC 1624) gives the checksum computed from scratch
+void expect_update(vector<uint16_t> words, const size_t index, const uint16_t new_word)
+{
+  const uint16_t before = checksum(words);
+  const uint16_t old_word = words.at(index);
+  words.at(index) = new_word;
+  test_should_be(InternetChecksum::update(before, old_word, new_word), checksum(words));
+}
+
+void update(default_random_engine& rd)
+{
+  uniform_int_distribution<uint16_t> word_dist;
+  const array<uint16_t, 4> edge_words {0x0000, 0x0001, 0xfffe, 0xffff};
+
+  for (unsigned int i = 0; i < 10000; i++) {
+    vector<uint16_t> words(10);
+    for (auto& word : words) {
+      word = word_dist(rd);
+    }
+    const size_t index = i % words.size();
+
+    expect_update(words, index, word_dist(rd));
+    expect_update(words, index, words[index]);
+    for (const uint16_t edge : edge_words) {
+      expect_update(words, index, edge);
+    }
+
+    // Make the words sum to 0xffff (-0), so the checksum is 0x0000, then change one word: the update
+    // starts from that checksum, or (changing it back) must arrive at it
+    words[(index + 1) % words.size()] = 0;
+    words[(index + 1) % words.size()] = checksum(words);
+    test_should_be(checksum(words), uint16_t {0x0000});
+    for (const uint16_t edge : edge_words) {
+      expect_update(words, index, edge);
+      vector<uint16_t> changed = words;
+      changed[index] = edge;
+      expect_update(changed, index, words[index]);
+    }
+  }
+
+  // The one case where the two disagree: data that becomes all zeros sums to +0 from scratch
+  // (checksum 0xffff) but to -0 by update (checksum 0x0000). Both are zero in one's complement, and
+  // no IPv4 header is all zeros (its first byte holds the version).
+  test_should_be(InternetChecksum::update(checksum({0x0000, 0x1234}), 0x1234, 0x0000),
+                 uint16_t {0x0000});
+  test_should_be(checksum({0x0000, 0x0000}), uint16_t {0xffff});
+}
+
+IPv4Header random_header(default_random_engine& rd)
+{
+  uniform_int_distribution<uint32_t> dist;
+  IPv4Header header;
+  header.tos = static_cast<uint8_t>(dist(rd));
+  header.len = static_cast<uint16_t>(dist(rd));
+  header.id = static_cast<uint16_t>(dist(rd));
+  header.df = dist(rd) % 2 == 0;
+  header.mf = dist(rd) % 2 == 0;
+  header.offset = static_cast<uint16_t>(dist(rd) & 0x1fff);
+  header.ttl = static_cast<uint8_t>(dist(rd));
+  header.proto = static_cast<uint8_t>(dist(rd));
+  header.src = dist(rd);
+  header.dst = dist(rd);
+  header.compute_checksum();
+  return header;
+}
+
+// Each setter leaves the checksum compute_checksum() would give the changed header
+template<class Set, class Assign>
+void expect_setter(const IPv4Header& header, Set set, Assign assign, const string& name)
+{
+  IPv4Header updated = header;
+  set(updated);
+  IPv4Header recomputed = header;
+  assign(recomputed);
+  recomputed.compute_checksum();
+  if (updated.cksum != recomputed.cksum) {
+    throw runtime_error(name + " left checksum " + to_string(updated.cksum) + " instead of "
+                        + to_string(recomputed.cksum));
+  }
+}
+
+void expect_setters(const IPv4Header& header, uint8_t ttl, uint32_t src, uint32_t dst)
+{
+  expect_setter(
+    header, [&](IPv4Header& h) { h.set_ttl(ttl); }, [&](IPv4Header& h) { h.ttl = ttl; }, "set_ttl");
+  expect_setter(
+    header, [&](IPv4Header& h) { h.set_src(src); }, [&](IPv4Header& h) { h.src = src; }, "set_src");
+  expect_setter(
+    header, [&](IPv4Header& h) { h.set_dst(dst); }, [&](IPv4Header& h) { h.dst = dst; }, "set_dst");
+}
+
+void ipv4_setters(default_random_engine& rd)
+{
+  uniform_int_distribution<uint32_t> dist;
+  for (unsigned int i = 0; i < 10000; i++) {
+    IPv4Header header = random_header(rd);
+    expect_setters(header, static_cast<uint8_t>(dist(rd)), dist(rd), dist(rd));
+    expect_setters(header, 0, 0, 0);
+    expect_setters(header, UINT8_MAX, UINT32_MAX, UINT32_MAX);
+    expect_setters(header, header.ttl, header.src, header.dst);
+
+    // A header whose checksum is 0x0000, changed from and back to
+    header.id = 0;
+    header.compute_checksum();
+    header.id = header.cksum;
+    header.compute_checksum();
+    test_should_be(header.cksum, uint16_t {0x0000});
+    expect_setters(header, static_cast<uint8_t>(dist(rd)), dist(rd), dist(rd));
+
+    const auto changed = [&header](auto assign) {
+      IPv4Header ret = header;
+      assign(ret);
+      ret.compute_checksum();
+      return ret;
+    };
+    expect_setters(changed([&](IPv4Header& h) { h.ttl = static_cast<uint8_t>(dist(rd)); }),
+                   header.ttl,
+                   header.src,
+                   header.dst);
+    expect_setters(
+      changed([&](IPv4Header& h) { h.src = dist(rd); }), header.ttl, header.src, header.dst);
+    expect_setters(
+      changed([&](IPv4Header& h) { h.dst = dist(rd); }), header.ttl, header.src, header.dst);
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    lengths_and_offsets(rd);
+    splits(rd);
+    extremes();
+    buffers(rd);
+    update(rd);
+    ipv4_setters(rd);
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+#include "checksum.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+using Kernel = InternetChecksum::Kernel;
+
+string kernel_name(const Kernel kernel)
+{
+  switch (kernel) {
+    case Kernel::BYTEWISE:
+      return "bytewise";
+    case Kernel::WORDS:
+      return "64-bit words";
+    case Kernel::SSE2:
+      return "SSE2";
+    case Kernel::AVX2:
+      return "AVX2";
+  }
+  return "unknown";
+}
+
+// Checksums each segment, given as a list of buffers. Returns the sum of the checksums, so the
+// work cannot be optimized away.
+uint64_t checksum_all(const Kernel kernel,
+                      const vector<vector<string_view>>& segments,
+                      const size_t rounds)
+{
+  uint64_t ret = 0;
+  for (size_t round = 0; round < rounds; round++) {
+    for (const auto& segment : segments) {
+      InternetChecksum check {0x1234};
+      for (const auto& buffer : segment) {
+        check.add(buffer, kernel);
+      }
+      ret += check.value();
+    }
+  }
+  return ret;
+}
+
+// Returns gigabits per second checksummed
+double speed_test(const Kernel kernel,
+                  const vector<vector<string_view>>& segments,
+                  const size_t total_bytes)
+{
+  constexpr size_t rounds = 20;
+
+  const auto start_time = steady_clock::now();
+  const uint64_t checksums = checksum_all(kernel, segments, rounds);
+  const auto stop_time = steady_clock::now();
+
+  if (checksums == 0) {
+    throw runtime_error("kernel " + kernel_name(kernel) + " computed no checksums");
+  }
+
+  const auto test_duration = duration_cast<duration<double>>(stop_time - start_time);
+  const double gigabits_per_second
+    = static_cast<double>(rounds * total_bytes) * 8.0 / test_duration.count() / 1e9;
+
+  cout << "InternetChecksum with the " << kernel_name(kernel) << " kernel reached " << fixed
+       << setprecision(2) << gigabits_per_second << " Gbit/s.\n";
+
+  if (gigabits_per_second < 0.5) {
+    throw runtime_error("checksum did not meet minimum speed of 0.5 Gbit/s.");
+  }
+
+  return gigabits_per_second;
+}
+
+void program_body()
+{
+  constexpr size_t num_segments = 20000;
+  constexpr size_t header_size = 20;
+
+  default_random_engine rd {144};
+  uniform_int_distribution<char> byte_dist;
+  uniform_int_distribution<size_t> payload_dist {0, 1460};
+
+  // Keep every segment's bytes in one string, and checksum views into it
+  string data;
+  vector<size_t> payload_sizes;
+  for (size_t i = 0; i < num_segments; i++) {
+    payload_sizes.push_back(i % 4 == 0 ? 1460 : payload_dist(rd));
+    for (size_t j = 0; j < header_size + payload_sizes.back(); j++) {
+      data += byte_dist(rd);
+    }
+  }
+
+  // Half of the payloads are split at an odd length, as if spread across two Buffers
+  vector<vector<string_view>> segments;
+  string_view remaining {data};
+  for (size_t i = 0; i < num_segments; i++) {
+    const size_t split = i % 2 == 0 ? 0 : (payload_sizes[i] / 2) | 1U;
+    const string_view header = remaining.substr(0, header_size);
+    const string_view payload = remaining.substr(header_size, payload_sizes[i]);
+    const size_t split_at = min(split, payload.size());
+    segments.push_back({header, payload.substr(0, split_at), payload.substr(split_at)});
+    remaining.remove_prefix(header_size + payload_sizes[i]);
+  }
+  const size_t total_bytes = data.size();
+
+  const double before = speed_test(Kernel::BYTEWISE, segments, total_bytes);
+  for (const Kernel kernel : {Kernel::WORDS, Kernel::SSE2, Kernel::AVX2}) {
+    if (InternetChecksum::supported(kernel)) {
+      speed_test(kernel, segments, total_bytes);
+    }
+  }
+  const double after = speed_test(InternetChecksum::fastest_kernel(), segments, total_bytes);
+
+  fstream debug_output;
+  debug_output.open("/dev/tty");
+
+  debug_output << "        Fastest checksum kernel ("
+               << kernel_name(InternetChecksum::fastest_kernel()) << "): " << fixed
+               << setprecision(2) << after / before << "x the bytewise rate\n";
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch (const exception& e) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
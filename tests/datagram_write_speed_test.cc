@@ -0,0 +1,130 @@
+#include "exception.hh"
+#include "file_descriptor.hh"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+enum class WriteMode
+{
+  ONE_AT_A_TIME, // one writev per datagram, as the adapters used to do
+  WRITE_BATCH,   // FileDescriptor::write_datagrams (the TUN/TAP path)
+  SEND_BATCH,    // FileDescriptor::send_datagrams (sendmmsg)
+};
+
+string mode_name(const WriteMode mode)
+{
+  switch (mode) {
+    case WriteMode::ONE_AT_A_TIME:
+      return "one write per datagram";
+    case WriteMode::WRITE_BATCH:
+      return "write_datagrams";
+    case WriteMode::SEND_BATCH:
+      return "send_datagrams";
+  }
+  return "unknown";
+}
+
+// Returns datagrams per second written through a SOCK_DGRAM socketpair
+double speed_test(const WriteMode mode,
+                  const size_t num_datagrams, // NOLINT(bugprone-easily-swappable-parameters)
+                  const size_t batch_size,    // NOLINT(bugprone-easily-swappable-parameters)
+                  const size_t payload_size)  // NOLINT(bugprone-easily-swappable-parameters)
+{
+  array<int, 2> fds {};
+  CheckSystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_DGRAM, 0, fds.data()));
+  FileDescriptor sender {fds[0]};
+  FileDescriptor receiver {fds[1]};
+
+  // Each datagram is laid out like a serialized Ethernet frame: header, IP header, payload
+  vector<vector<Buffer>> batch;
+  for (size_t i = 0; i < batch_size; i++) {
+    batch.push_back({string(14, 'e'), string(20, 'i'), string(payload_size, 'x')});
+  }
+  const size_t datagram_size = 14 + 20 + payload_size;
+
+  size_t received = 0;
+  thread reader {[&] {
+    string buffer;
+    while (received < num_datagrams) {
+      buffer.clear();
+      receiver.read(buffer);
+      if (buffer.size() != datagram_size) {
+        throw runtime_error("received a datagram of the wrong size");
+      }
+      received++;
+    }
+  }};
+
+  const auto start_time = steady_clock::now();
+  for (size_t sent = 0; sent < num_datagrams; sent += batch_size) {
+    switch (mode) {
+      case WriteMode::ONE_AT_A_TIME:
+        for (const auto& datagram : batch) {
+          sender.write(datagram);
+        }
+        break;
+      case WriteMode::WRITE_BATCH:
+        sender.write_datagrams(batch);
+        break;
+      case WriteMode::SEND_BATCH:
+        sender.send_datagrams(batch);
+        break;
+    }
+  }
+  reader.join();
+  const auto stop_time = steady_clock::now();
+
+  const auto test_duration = duration_cast<duration<double>>(stop_time - start_time);
+  const double datagrams_per_second = static_cast<double>(received) / test_duration.count();
+
+  cout << "Writing " << datagram_size << "-byte datagrams in batches of " << batch_size
+       << " with " << mode_name(mode) << " reached " << fixed << setprecision(0)
+       << datagrams_per_second << " datagrams/s.\n";
+
+  if (datagrams_per_second < 10000) {
+    throw runtime_error("datagram writes did not meet minimum speed of 10,000 datagrams/s.");
+  }
+
+  return datagrams_per_second;
+}
+
+void program_body()
+{
+  constexpr size_t num_datagrams = 200000;
+  constexpr size_t batch_size = 32;
+  constexpr size_t payload_size = 1460;
+
+  const double before
+    = speed_test(WriteMode::ONE_AT_A_TIME, num_datagrams, batch_size, payload_size);
+  speed_test(WriteMode::WRITE_BATCH, num_datagrams, batch_size, payload_size);
+  const double after = speed_test(WriteMode::SEND_BATCH, num_datagrams, batch_size, payload_size);
+
+  fstream debug_output;
+  debug_output.open("/dev/tty");
+
+  debug_output << "             Batched datagram writes: " << fixed << setprecision(2)
+               << after / before << "x the rate of one write per datagram\n";
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch (const exception& e) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
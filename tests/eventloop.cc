@@ -0,0 +1,190 @@
+#include "eventloop.hh"
+#include "exception.hh"
+
+#include <array>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+pair<FileDescriptor, FileDescriptor> make_pipe()
+{
+  array<int, 2> fds {};
+  CheckSystemCall("pipe", ::pipe(fds.data()));
+  return {FileDescriptor {fds[0]}, FileDescriptor {fds[1]}};
+}
+
+pair<FileDescriptor, FileDescriptor> make_socket_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()));
+  return {FileDescriptor {fds[0]}, FileDescriptor {fds[1]}};
+}
+
+string name(EventLoop::Backend backend)
+{
+  return backend == EventLoop::Backend::Epoll ? "Epoll" : "Poll";
+}
+
+void expect_result(EventLoop::Result actual, EventLoop::Result expected, const string& what)
+{
+  if (actual != expected) {
+    throw runtime_error(what + ": wait_next_event() returned " + to_string(static_cast<int>(actual))
+                        + " instead of " + to_string(static_cast<int>(expected)));
+  }
+}
+
+// A rule for a new file whose fd number the kernel reused from a closed one must see that file
+void reused_fd_number(EventLoop::Backend backend)
+{
+  const string what = name(backend) + ", reused fd number";
+  EventLoop loop {backend};
+  const size_t category = loop.add_category("pipe");
+
+  auto [old_read, old_write] = make_pipe();
+  const int old_number = old_read.fd_num();
+  bool old_cancelled = false;
+  loop.add_rule(
+    category,
+    old_read,
+    Direction::In,
+    [] { throw runtime_error("the closed pipe should not be read"); },
+    [] { return true; },
+    [&] { old_cancelled = true; });
+  expect_result(loop.wait_next_event(0), EventLoop::Result::Timeout, what);
+
+  old_read.close();
+  old_write.close();
+  auto [new_read, new_write] = make_pipe();
+  if (new_read.fd_num() != old_number) {
+    throw runtime_error(what + ": the kernel did not reuse the fd number");
+  }
+
+  string data;
+  loop.add_rule(
+    category, new_read, Direction::In, [&] { new_read.read(data); }, [&] { return data.empty(); });
+  new_write.write("x");
+  expect_result(loop.wait_next_event(1000), EventLoop::Result::Success, what);
+  if (data != "x" or not old_cancelled) {
+    throw runtime_error(what + ": the new pipe was not read, or the old rule was not cancelled");
+  }
+}
+
+string str(const vector<string>& names)
+{
+  string out = "{";
+  for (const auto& x : names) {
+    out += " " + x;
+  }
+  return out + " }";
+}
+
+// With Dispatch::AllReady, one call runs every ready rule at most once, in the order the rules were
+// added (whatever order their fds became ready in), and skips a rule that an earlier callback in the
+// same call cancelled
+void all_ready(EventLoop::Backend backend)
+{
+  const string what = name(backend) + ", all ready";
+  EventLoop loop {backend, EventLoop::Dispatch::AllReady};
+  const size_t category = loop.add_category("ready");
+
+  // Rules "a" (In) and "e" (Out) share a socket; "b", "c" and "d" each read a pipe
+  auto [socket, peer] = make_socket_pair();
+  auto [b_read, b_write] = make_pipe();
+  auto [c_read, c_write] = make_pipe();
+  auto [d_read, d_write] = make_pipe();
+
+  vector<string> ran;
+  string buffer;
+  optional<EventLoop::RuleHandle> c_rule;
+  bool cancel_c = false;
+  loop.add_rule(category, socket, Direction::In, [&] {
+    ran.emplace_back("a");
+    socket.read(buffer);
+    if (cancel_c) {
+      c_rule->cancel();
+    }
+  });
+  loop.add_rule(category, b_read, Direction::In, [&] {
+    ran.emplace_back("b");
+    b_read.read(buffer);
+  });
+  c_rule = loop.add_rule(category, c_read, Direction::In, [&] {
+    ran.emplace_back("c");
+    c_read.read(buffer);
+  });
+  loop.add_rule(category, d_read, Direction::In, [&] {
+    ran.emplace_back("d");
+    d_read.read(buffer);
+  });
+  bool e_interested = false;
+  loop.add_rule(
+    category,
+    socket,
+    Direction::Out,
+    [&] {
+      ran.emplace_back("e");
+      socket.write("e");
+    },
+    [&] { return e_interested; });
+
+  // Make the fds readable in the opposite order to the rules, then expect one call to run `expected`
+  const auto expect_ran = [&](const vector<string>& expected) {
+    d_write.write("d");
+    c_write.write("c");
+    b_write.write("b");
+    peer.write("a");
+    expect_result(loop.wait_next_event(0), EventLoop::Result::Success, what);
+    if (ran != expected) {
+      throw runtime_error(what + ": rules " + str(ran) + " ran instead of " + str(expected));
+    }
+    ran.clear();
+  };
+
+  // Nothing is ready yet
+  expect_result(loop.wait_next_event(0), EventLoop::Result::Timeout, what);
+
+  expect_ran({"a", "b", "c", "d"});
+
+  // A rule that becomes interested runs in the order it was added, even on a shared fd
+  e_interested = true;
+  expect_ran({"a", "b", "c", "d", "e"});
+
+  // "e" stays writable, but runs only once per call
+  expect_result(loop.wait_next_event(0), EventLoop::Result::Success, what);
+  if (ran != vector<string> {"e"}) {
+    throw runtime_error(what + ": rules " + str(ran) + " ran instead of { e }");
+  }
+  ran.clear();
+
+  // "a" cancels "c", which is ready in the same call
+  cancel_c = true;
+  expect_ran({"a", "b", "d", "e"});
+  expect_ran({"a", "b", "d", "e"});
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    for (const auto backend : {EventLoop::Backend::Poll, EventLoop::Backend::Epoll}) {
+      reused_fd_number(backend);
+      all_ready(backend);
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
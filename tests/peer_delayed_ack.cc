@@ -0,0 +1,149 @@
+#include "peer_test_harness.hh"
+#include "random.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t FULL = TCPConfig::MAX_PAYLOAD_SIZE;
+
+// The test's side of one connection: its ISN and the TCPPeer's
+struct Ends
+{
+  Wrap32 isn;
+  Wrap32 peer_isn;
+
+  // A segment from the test carrying `size` bytes at stream offset `offset`
+  SegmentArrives data(uint64_t offset, size_t size) const
+  {
+    return SegmentArrives {}
+      .with_seqno(isn + 1 + static_cast<uint32_t>(offset))
+      .with_payload_size(size)
+      .with_ackno(peer_isn + 1)
+      .with_win(UINT16_MAX);
+  }
+
+  // The peer's ACK of the first `bytes` bytes of the stream
+  ExpectAck ack(uint64_t bytes) const { return ExpectAck {isn + 1 + static_cast<uint32_t>(bytes)}; }
+};
+
+// Open the connection from the test's side, so that the peer's next segment can only be an ACK
+Ends handshake(TCPPeerTestHarness& test, const Wrap32 isn, const Wrap32 peer_isn)
+{
+  test.execute(SegmentArrives {}.with_seqno(isn).with_syn().with_win(UINT16_MAX).with_mss(FULL));
+  test.execute(ExpectSegment {}.with_syn(true).with_ackno(isn + 1));
+  test.execute(SegmentArrives {}.with_seqno(isn + 1).with_ackno(peer_isn + 1).with_win(UINT16_MAX));
+  test.execute(ExpectNoSegment {});
+  return {isn, peer_isn};
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      const Wrap32 peer_isn(rd());
+      cfg.fixed_isn = peer_isn;
+
+      TCPPeerTestHarness test {"Every second full-sized segment is acknowledged", cfg};
+      const Ends ends = handshake(test, isn, peer_isn);
+      test.execute(ends.data(0, FULL));
+      test.execute(ExpectNoSegment {});
+      test.execute(ends.data(FULL, FULL));
+      test.execute(ends.ack(2 * FULL));
+      test.execute(ends.data(2 * FULL, FULL));
+      test.execute(ExpectNoSegment {});
+      test.execute(ends.data(3 * FULL, FULL));
+      test.execute(ends.ack(4 * FULL));
+      test.execute(ExpectNoSegment {});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      const Wrap32 peer_isn(rd());
+      cfg.fixed_isn = peer_isn;
+      cfg.ack_delay = 25;
+
+      TCPPeerTestHarness test {"A lone segment is acknowledged after ack_delay", cfg};
+      const Ends ends = handshake(test, isn, peer_isn);
+      test.execute(ends.data(0, FULL));
+      test.execute(ExpectNoSegment {});
+      test.execute(ExpectNextTimer {25});
+      test.execute(Tick {24});
+      test.execute(ExpectNoSegment {});
+      test.execute(Tick {1});
+      test.execute(ends.ack(FULL));
+      test.execute(Tick {1000});
+      test.execute(ExpectNoSegment {});
+
+      // The delay starts over with the next segment
+      test.execute(ends.data(FULL, FULL / 2));
+      test.execute(Tick {24});
+      test.execute(ExpectNoSegment {});
+      test.execute(Tick {1});
+      test.execute(ends.ack(FULL + FULL / 2));
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      const Wrap32 peer_isn(rd());
+      cfg.fixed_isn = peer_isn;
+
+      TCPPeerTestHarness test {"Out-of-order data and a gap fill are acknowledged at once", cfg};
+      const Ends ends = handshake(test, isn, peer_isn);
+      test.execute(ends.data(0, FULL));
+      test.execute(ExpectNoSegment {});
+
+      // A segment beyond a gap is acknowledged at once (a duplicate ACK), taking the delayed ACK
+      // along
+      test.execute(ends.data(2 * FULL, FULL));
+      test.execute(ends.ack(FULL));
+      test.execute(ExpectNoSegment {});
+
+      // So is the segment that fills the gap
+      test.execute(ends.data(FULL, FULL));
+      test.execute(ends.ack(3 * FULL));
+      test.execute(ExpectNoSegment {});
+
+      // After which in-order data is delayed again
+      test.execute(ends.data(3 * FULL, FULL));
+      test.execute(ExpectNoSegment {});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      const Wrap32 peer_isn(rd());
+      cfg.fixed_isn = peer_isn;
+      cfg.delayed_ack = false;
+
+      TCPPeerTestHarness test {"Without delayed ACKs, every segment is acknowledged", cfg};
+      const Ends ends = handshake(test, isn, peer_isn);
+      test.execute(ends.data(0, FULL));
+      test.execute(ends.ack(FULL));
+      test.execute(ends.data(FULL, FULL));
+      test.execute(ends.ack(2 * FULL));
+      test.execute(ends.data(2 * FULL, 1));
+      test.execute(ends.ack(2 * FULL + 1));
+      test.execute(ExpectNoSegment {});
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "common.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+#include "tcp_segment.hh"
+#include "wrapping_integers.hh"
+
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+
+static std::string to_string(const TCPSegment& seg)
+{
+  std::ostringstream o;
+  o << "(seqno=" << seg.sender_message.seqno;
+  if (seg.sender_message.SYN) {
+    o << " +SYN";
+  }
+  if (not seg.sender_message.payload.empty()) {
+    o << " payload_len=" << seg.sender_message.payload.size();
+  }
+  if (seg.sender_message.FIN) {
+    o << " +FIN";
+  }
+  o << " ack=" << to_string(seg.receiver_message.ackno) << ")";
+  return o.str();
+}
+
+// The test plays the other end of the connection, handing the TCPPeer segments and checking the
+// ones it sends back
+class TCPPeerTestHarness : public TestHarness<TCPPeer>
+{
+public:
+  TCPPeerTestHarness(std::string name, const TCPConfig& config)
+    : TestHarness(move(name),
+                  config.delayed_ack ? "ack_delay=" + std::to_string(config.ack_delay) + " ms"
+                                     : std::string {"delayed ACKs off"},
+                  TCPPeer {config})
+  {}
+};
+
+struct SegmentArrives : public Action<TCPPeer>
+{
+  TCPSegment seg_ {};
+  size_t payload_size_ {};
+
+  // TCPPeer takes the payload's string out of its Buffer, so each delivery gets a fresh one
+  TCPSegment segment() const
+  {
+    TCPSegment seg = seg_;
+    seg.sender_message.payload = std::string(payload_size_, 'x');
+    return seg;
+  }
+
+  SegmentArrives& with_seqno(Wrap32 seqno)
+  {
+    seg_.sender_message.seqno = seqno;
+    return *this;
+  }
+
+  SegmentArrives& with_syn()
+  {
+    seg_.sender_message.SYN = true;
+    return *this;
+  }
+
+  SegmentArrives& with_payload_size(size_t size)
+  {
+    payload_size_ = size;
+    return *this;
+  }
+
+  SegmentArrives& with_ackno(Wrap32 ackno)
+  {
+    seg_.receiver_message.ackno = ackno;
+    return *this;
+  }
+
+  SegmentArrives& with_win(uint32_t win)
+  {
+    seg_.receiver_message.window_size = win;
+    return *this;
+  }
+
+  SegmentArrives& with_mss(uint16_t mss)
+  {
+    seg_.mss = mss;
+    return *this;
+  }
+
+  std::string description() const override
+  {
+    const TCPSegment seg = segment();
+    return "segment arrives " + to_string(seg);
+  }
+  void execute(TCPPeer& peer) const override { peer.receive(segment()); }
+};
+
+struct Tick : public Action<TCPPeer>
+{
+  uint64_t ms_;
+
+  explicit Tick(uint64_t ms) : ms_(ms) {}
+  std::string description() const override { return std::to_string(ms_) + " ms pass"; }
+  void execute(TCPPeer& peer) const override { peer.tick(ms_); }
+};
+
+struct ExpectNextTimer : public ExpectNumber<TCPPeer, uint64_t>
+{
+  static constexpr uint64_t NONE = UINT64_MAX;
+
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "ms_until_next_timer (or NONE)"; }
+  uint64_t value(TCPPeer& peer) const override { return peer.ms_until_next_timer().value_or(NONE); }
+};
+
+struct ExpectNoSegment : public Expectation<TCPPeer>
+{
+  std::string description() const override { return "nothing to send"; }
+  void execute(TCPPeer& peer) const override
+  {
+    const auto seg = peer.maybe_send();
+    if (seg.has_value()) {
+      throw ExpectationViolation {"TCPPeer sent an unexpected segment: " + to_string(seg.value())};
+    }
+  }
+};
+
+struct ExpectSegment : public Expectation<TCPPeer>
+{
+  std::optional<bool> syn {};
+  std::optional<Wrap32> ackno {};
+  std::optional<size_t> sequence_length {};
+
+  ExpectSegment& with_syn(bool syn_)
+  {
+    syn = syn_;
+    return *this;
+  }
+
+  ExpectSegment& with_ackno(Wrap32 ackno_)
+  {
+    ackno = ackno_;
+    return *this;
+  }
+
+  ExpectSegment& with_sequence_length(size_t sequence_length_)
+  {
+    sequence_length = sequence_length_;
+    return *this;
+  }
+
+  std::string description() const override
+  {
+    std::ostringstream o;
+    o << "segment sent with";
+    if (syn.has_value()) {
+      o << (syn.value() ? " +SYN" : " (no SYN)");
+    }
+    if (ackno.has_value()) {
+      o << " ack=" << ackno.value();
+    }
+    if (sequence_length.has_value()) {
+      o << " sequence_length=" << sequence_length.value();
+    }
+    return o.str();
+  }
+
+  void execute(TCPPeer& peer) const override
+  {
+    const auto maybe_seg = peer.maybe_send();
+    if (not maybe_seg.has_value()) {
+      throw ExpectationViolation("expected a segment, but none was sent");
+    }
+    const TCPSegment& seg = maybe_seg.value();
+
+    if (syn.has_value() and seg.sender_message.SYN != syn.value()) {
+      throw ExpectationViolation("SYN flag", syn.value(), seg.sender_message.SYN);
+    }
+    if (ackno.has_value() and seg.receiver_message.ackno != ackno) {
+      throw ExpectationViolation("ackno", ackno, seg.receiver_message.ackno);
+    }
+    if (sequence_length.has_value()
+        and seg.sender_message.sequence_length() != sequence_length.value()) {
+      throw ExpectationViolation(
+        "sequence_length", sequence_length.value(), seg.sender_message.sequence_length());
+    }
+  }
+};
+
+// An ACK that uses no sequence numbers of its own
+struct ExpectAck : public ExpectSegment
+{
+  explicit ExpectAck(Wrap32 ackno_) { with_ackno(ackno_).with_sequence_length(0); }
+};
@@ -9,6 +9,7 @@
 #include <queue>
 #include <random>
 #include <tuple>
+#include <vector>
 
 using namespace std;
 using namespace std::chrono;
@@ -76,7 +77,8 @@ void speed_test(const size_t num_chunks,  // NOLINT(bugprone-easily-swappable-pa
   debug_output.open("/dev/tty");
 
   cout << "Reassembler to ByteStream with capacity=" << capacity << " reached " << fixed
-       << setprecision(2) << gigabits_per_second << " Gbit/s.\n";
+       << setprecision(2) << gigabits_per_second << " Gbit/s (" << reassembler.fast_path_inserts()
+       << " fast-path and " << reassembler.slow_path_inserts() << " slow-path inserts).\n";
 
   debug_output << "             Reassembler throughput: " << fixed << setprecision(2)
                << gigabits_per_second << " Gbit/s\n";
@@ -86,9 +88,86 @@ void speed_test(const size_t num_chunks,  // NOLINT(bugprone-easily-swappable-pa
   }
 }
 
+// Heavy reordering: every window's worth of data arrives as small segments in random order
+void reorder_speed_test(const size_t num_chunks,   // NOLINT(bugprone-easily-swappable-parameters)
+                        const size_t capacity,     // NOLINT(bugprone-easily-swappable-parameters)
+                        const size_t segment_size, // NOLINT(bugprone-easily-swappable-parameters)
+                        const size_t random_seed)  // NOLINT(bugprone-easily-swappable-parameters)
+{
+  default_random_engine rd {random_seed};
+
+  // Generate the data to be written
+  const string data = [&] {
+    uniform_int_distribution<char> ud;
+    string ret;
+    for (size_t i = 0; i < num_chunks * capacity; ++i) {
+      ret += ud(rd);
+    }
+    return ret;
+  }();
+
+  // Split each window into segments and shuffle them
+  vector<tuple<uint64_t, string, bool>> split_data;
+  for (size_t window = 0; window < data.size(); window += capacity) {
+    const size_t first_segment = split_data.size();
+    for (size_t i = window; i < min(window + capacity, data.size()); i += segment_size) {
+      split_data.emplace_back(i, data.substr(i, segment_size), i + segment_size >= data.size());
+    }
+    shuffle(split_data.begin() + static_cast<ptrdiff_t>(first_segment), split_data.end(), rd);
+  }
+
+  ByteStream stream {capacity};
+  Reassembler reassembler;
+
+  string output_data;
+  output_data.reserve(data.size());
+
+  const auto start_time = steady_clock::now();
+  for (auto& next : split_data) {
+    reassembler.insert(
+      get<uint64_t>(next), move(get<string>(next)), get<bool>(next), stream.writer());
+
+    while (stream.reader().bytes_buffered()) {
+      output_data += stream.reader().peek();
+      stream.reader().pop(output_data.size() - stream.reader().bytes_popped());
+    }
+  }
+
+  const auto stop_time = steady_clock::now();
+
+  if (not stream.reader().is_finished()) {
+    throw runtime_error("Reassembler did not close ByteStream when finished");
+  }
+
+  if (data != output_data) {
+    throw runtime_error("Mismatch between data written and read");
+  }
+
+  auto test_duration = duration_cast<duration<double>>(stop_time - start_time);
+  auto bytes_per_second = static_cast<double>(num_chunks * capacity) / test_duration.count();
+  auto bits_per_second = 8 * bytes_per_second;
+  auto gigabits_per_second = bits_per_second / 1e9;
+
+  fstream debug_output;
+  debug_output.open("/dev/tty");
+
+  cout << "Reassembler to ByteStream with capacity=" << capacity
+       << ", reordered segment_size=" << segment_size << " reached " << fixed << setprecision(2)
+       << gigabits_per_second << " Gbit/s (" << reassembler.fast_path_inserts() << " fast-path and "
+       << reassembler.slow_path_inserts() << " slow-path inserts).\n";
+
+  debug_output << "   Reassembler (reordered) throughput: " << fixed << setprecision(2)
+               << gigabits_per_second << " Gbit/s\n";
+
+  if (gigabits_per_second < 0.1) {
+    throw runtime_error("Reassembler did not meet minimum speed of 0.1 Gbit/s.");
+  }
+}
+
 void program_body()
 {
   speed_test(10000, 1500, 1370);
+  reorder_speed_test(200, 64000, 100, 1370);
 }
 
 int main()
@@ -8,6 +8,7 @@
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 using ReceiverSet = std::pair<StreamAndReassembler, TCPReceiver>;
 
@@ -50,11 +51,11 @@ public:
   using TestHarness<ReceiverSet>::execute;
 };
 
-struct ExpectWindow : public ExpectNumber<ReceiverSet, uint16_t>
+struct ExpectWindow : public ExpectNumber<ReceiverSet, uint32_t>
 {
   using ExpectNumber::ExpectNumber;
   std::string name() const override { return "window_size"; }
-  uint16_t value(ReceiverSet& rs) const override
+  uint32_t value(ReceiverSet& rs) const override
   {
     return rs.second.send(rs.first.first.writer()).window_size;
   }
@@ -70,6 +71,38 @@ struct ExpectAckno : public ExpectNumber<ReceiverSet, std::optional<Wrap32>>
   }
 };
 
+struct ExpectSackBlocks : public Expectation<ReceiverSet>
+{
+  std::vector<std::pair<Wrap32, Wrap32>> blocks_;
+
+  explicit ExpectSackBlocks(std::vector<std::pair<Wrap32, Wrap32>> blocks)
+    : blocks_(std::move(blocks))
+  {}
+
+  static std::string to_string(const std::vector<std::pair<Wrap32, Wrap32>>& blocks)
+  {
+    std::ostringstream ss;
+    ss << "{";
+    for (const auto& [left, right] : blocks) {
+      ss << " [" << left << ", " << right << ")";
+    }
+    ss << " }";
+    return ss.str();
+  }
+
+  std::string description() const override { return "SACK blocks = " + to_string(blocks_); }
+
+  void execute(ReceiverSet& rs) const override
+  {
+    const auto blocks = rs.second.send(rs.first.first.writer(), rs.first.second).sack_blocks;
+    if (blocks != blocks_) {
+      throw ExpectationViolation("The TCPReceiver should have reported SACK blocks "
+                                 + to_string(blocks_) + ", but instead it was "
+                                 + to_string(blocks) + ".");
+    }
+  }
+};
+
 struct ExpectAcknoBetween : public Expectation<ReceiverSet>
 {
   Wrap32 isn_;
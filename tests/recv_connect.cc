@@ -94,23 +94,23 @@ int main()
     }
 
     {
-      TCPReceiverTestHarness test {"window size at max", UINT16_MAX};
+      TCPReceiverTestHarness test {"window size at 16-bit max", UINT16_MAX};
       test.execute(ExpectWindow {UINT16_MAX});
     }
 
     {
-      TCPReceiverTestHarness test {"window size at max+1", UINT16_MAX + 1};
-      test.execute(ExpectWindow {UINT16_MAX});
+      TCPReceiverTestHarness test {"window size at 16-bit max+1", UINT16_MAX + 1};
+      test.execute(ExpectWindow {UINT16_MAX + 1});
     }
 
     {
-      TCPReceiverTestHarness test {"window size at max+5", UINT16_MAX + 5};
-      test.execute(ExpectWindow {UINT16_MAX});
+      TCPReceiverTestHarness test {"window size at 16-bit max+5", UINT16_MAX + 5};
+      test.execute(ExpectWindow {UINT16_MAX + 5});
     }
 
     {
       TCPReceiverTestHarness test {"window size at 10M", 10'000'000};
-      test.execute(ExpectWindow {UINT16_MAX});
+      test.execute(ExpectWindow {10'000'000});
     }
   } catch (const exception& e) {
     cerr << e.what() << endl;
@@ -0,0 +1,64 @@
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> {0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test {"no SACK blocks before SYN or without holes", 4000};
+      test.execute(ExpectSackBlocks {{}});
+      test.execute(SegmentArrives {}.with_syn().with_seqno(isn));
+      test.execute(ExpectSackBlocks {{}});
+      test.execute(SegmentArrives {}.with_seqno(isn + 1).with_data("abcd"));
+      test.execute(ExpectAckno {Wrap32 {isn + 5}});
+      test.execute(ExpectSackBlocks {{}});
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> {0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test {"SACK blocks follow the holes", 4000};
+      test.execute(SegmentArrives {}.with_syn().with_seqno(isn));
+      test.execute(SegmentArrives {}.with_seqno(isn + 5).with_data("efgh"));
+      test.execute(ExpectAckno {Wrap32 {isn + 1}});
+      test.execute(ExpectSackBlocks {{{Wrap32 {isn + 5}, Wrap32 {isn + 9}}}});
+      test.execute(SegmentArrives {}.with_seqno(isn + 13).with_data("mnop"));
+      test.execute(ExpectSackBlocks {
+        {{Wrap32 {isn + 5}, Wrap32 {isn + 9}}, {Wrap32 {isn + 13}, Wrap32 {isn + 17}}}});
+      test.execute(SegmentArrives {}.with_seqno(isn + 9).with_data("ijkl"));
+      test.execute(ExpectSackBlocks {{{Wrap32 {isn + 5}, Wrap32 {isn + 17}}}});
+      test.execute(SegmentArrives {}.with_seqno(isn + 1).with_data("abcd"));
+      test.execute(ExpectAckno {Wrap32 {isn + 17}});
+      test.execute(ExpectSackBlocks {{}});
+      test.execute(ReadAll {"abcdefghijklmnop"});
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> {0, UINT32_MAX}(rd);
+      TCPReceiverTestHarness test {"at most MAX_SACK_BLOCKS blocks", 4000};
+      test.execute(SegmentArrives {}.with_syn().with_seqno(isn));
+      for (uint32_t i = 0; i < 6; i++) {
+        test.execute(SegmentArrives {}.with_seqno(isn + 3 + 4 * i).with_data("xx"));
+      }
+      test.execute(ExpectSackBlocks {{{Wrap32 {isn + 3}, Wrap32 {isn + 5}},
+                                      {Wrap32 {isn + 7}, Wrap32 {isn + 9}},
+                                      {Wrap32 {isn + 11}, Wrap32 {isn + 13}},
+                                      {Wrap32 {isn + 15}, Wrap32 {isn + 17}}}});
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
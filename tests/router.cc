@@ -129,56 +129,81 @@ private:
 
   std::unordered_map<string, Host> _hosts {};
 
-  static void exchange_frames(const string& x_name,
-                              AsyncNetworkInterface& x,
-                              const string& y_name,
-                              AsyncNetworkInterface& y)
+  // Deliver frames to the router with Router::recv_frame (the forwarding fast path) instead of
+  // through its interfaces and route()
+  bool _fast_path;
+
+  // Give a frame to `dst`, which may be one of the router's interfaces
+  void receive(AsyncNetworkInterface& dst, const EthernetFrame& frame)
+  {
+    if (_fast_path) {
+      for (const size_t id : {default_id, eth0_id, eth1_id, eth2_id, uun3_id, hs4_id, mit5_id}) {
+        if (&_router.interface(id) == &dst) {
+          // The router gets a copy sharing the frame's buffers, which it must not modify
+          vector<Buffer> before = serialize(frame);
+          const string expected = concat(before);
+          _router.recv_frame(id, EthernetFrame {frame});
+          vector<Buffer> after = serialize(frame);
+          if (concat(after) != expected) {
+            throw runtime_error("Router::recv_frame modified the caller's frame");
+          }
+          return;
+        }
+      }
+    }
+    dst.recv_frame(frame);
+  }
+
+  void exchange_frames(const string& x_name,
+                       AsyncNetworkInterface& x,
+                       const string& y_name,
+                       AsyncNetworkInterface& y)
   {
     deliver(x_name, x, y_name, y);
     deliver(y_name, y, x_name, x);
   }
 
-  static void exchange_frames(const string& x_name,
-                              AsyncNetworkInterface& x,
-                              const string& y_name,
-                              AsyncNetworkInterface& y,
-                              const string& z_name,
-                              AsyncNetworkInterface& z)
+  void exchange_frames(const string& x_name,
+                       AsyncNetworkInterface& x,
+                       const string& y_name,
+                       AsyncNetworkInterface& y,
+                       const string& z_name,
+                       AsyncNetworkInterface& z)
   {
     deliver(x_name, x, y_name, y, z_name, z);
     deliver(y_name, y, x_name, x, z_name, z);
     deliver(z_name, z, x_name, x, y_name, y);
   }
 
-  static void deliver(const string& src_name,
-                      AsyncNetworkInterface& src,
-                      const string& dst_name,
-                      AsyncNetworkInterface& dst)
+  void deliver(const string& src_name,
+               AsyncNetworkInterface& src,
+               const string& dst_name,
+               AsyncNetworkInterface& dst)
   {
     while (optional<EthernetFrame> frame = src.maybe_send()) {
       cerr << "Transferring frame from " << src_name << " to " << dst_name << ": "
            << summary(*frame) << "\n";
-      dst.recv_frame(*frame);
+      receive(dst, *frame);
     }
   }
 
-  static void deliver(const string& src_name,
-                      AsyncNetworkInterface& src,
-                      const string& dst1_name,
-                      AsyncNetworkInterface& dst1,
-                      const string& dst2_name,
-                      AsyncNetworkInterface& dst2)
+  void deliver(const string& src_name,
+               AsyncNetworkInterface& src,
+               const string& dst1_name,
+               AsyncNetworkInterface& dst1,
+               const string& dst2_name,
+               AsyncNetworkInterface& dst2)
   {
     while (optional<EthernetFrame> frame = src.maybe_send()) {
       cerr << "Transferring frame from " << src_name << " to " << dst1_name << " and " << dst2_name
            << ": " << summary(*frame) << "\n";
-      dst1.recv_frame(*frame);
-      dst2.recv_frame(*frame);
+      receive(dst1, *frame);
+      receive(dst2, *frame);
     }
   }
 
 public:
-  Network()
+  explicit Network(bool fast_path)
     : default_id(
       _router.add_interface({random_router_ethernet_address(), Address {"171.67.76.46"}}))
     , eth0_id(_router.add_interface({random_router_ethernet_address(), Address {"10.0.0.1"}}))
@@ -187,6 +212,7 @@ public:
     , uun3_id(_router.add_interface({random_router_ethernet_address(), Address {"198.178.229.1"}}))
     , hs4_id(_router.add_interface({random_router_ethernet_address(), Address {"143.195.0.2"}}))
     , mit5_id(_router.add_interface({random_router_ethernet_address(), Address {"128.30.76.255"}}))
+    , _fast_path(fast_path)
   {
     _hosts.insert({"applesauce", {"applesauce", Address {"10.0.0.2"}, Address {"10.0.0.1"}}});
     _hosts.insert({"default_router", {"default_router", Address {"171.67.76.1"}, Address {"0"}}});
@@ -251,14 +277,15 @@ public:
   }
 };
 
-void network_simulator()
+void network_simulator(bool fast_path)
 {
   const string green = "\033[32;1m";
   const string normal = "\033[m";
 
-  cerr << green << "Constructing network." << normal << "\n";
+  cerr << green << "Constructing network" << (fast_path ? " (forwarding fast path)." : ".")
+       << normal << "\n";
 
-  Network network;
+  Network network {fast_path};
 
   cout << green << "\n\nTesting traffic between two ordinary hosts (applesauce to cherrypie)..."
        << normal << "\n\n";
@@ -342,7 +369,8 @@ void network_simulator()
 int main()
 {
   try {
-    network_simulator();
+    network_simulator(false);
+    network_simulator(true);
   } catch (const exception& e) {
     cerr << "\n\n\n";
     cerr << "\033[31;1mError: " << e.what() << "\033[m\n";
@@ -0,0 +1,192 @@
+#include "router.hh"
+
+#include "address.hh"
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr EthernetAddress host_ethernet_address {0x02, 0, 0, 0, 0, 0x10};
+constexpr EthernetAddress router_in_ethernet_address {0x02, 0, 0, 0, 0, 0x01};
+constexpr EthernetAddress router_out_ethernet_address {0x02, 0, 0, 0, 0, 0x02};
+constexpr EthernetAddress destination_ethernet_address {0x02, 0, 0, 0, 0, 0x20};
+
+// Serialized datagrams from 10.0.0.2 to random hosts in 192.168.0.0/16
+vector<vector<Buffer>> make_datagrams(const size_t count, const size_t payload_size)
+{
+  default_random_engine rd {1624};
+  uniform_int_distribution<uint32_t> host_dist {1, 0xfffe};
+
+  vector<vector<Buffer>> ret;
+  for (size_t i = 0; i < count; i++) {
+    InternetDatagram dgram;
+    dgram.header.src = Address {"10.0.0.2"}.ipv4_numeric();
+    dgram.header.dst = Address {"192.168.0.0"}.ipv4_numeric() | host_dist(rd);
+    dgram.header.id = static_cast<uint16_t>(i);
+    dgram.header.ttl = 64;
+    dgram.payload.emplace_back(string(payload_size, 'x'));
+    dgram.header.len = static_cast<uint16_t>(IPv4Header::LENGTH + payload_size);
+    dgram.header.compute_checksum();
+    ret.push_back(serialize(dgram));
+  }
+  return ret;
+}
+
+// The per-datagram work of forwarding at the IP layer: parse and verify the header, decrement the
+// TTL and fix up the checksum, and serialize again. Returns datagrams per second.
+double header_speed_test(const vector<vector<Buffer>>& datagrams, const bool incremental)
+{
+  constexpr size_t rounds = 20;
+
+  size_t buffers_out = 0; // keeps the serialization from being optimized away
+  const auto start_time = steady_clock::now();
+  for (size_t round = 0; round < rounds; round++) {
+    for (const auto& serialized : datagrams) {
+      InternetDatagram dgram;
+      if (not parse(dgram, serialized)) {
+        throw runtime_error("failed to parse a datagram");
+      }
+      if (incremental) {
+        dgram.header.set_ttl(dgram.header.ttl - 1);
+      } else {
+        dgram.header.ttl--;
+        dgram.header.compute_checksum();
+      }
+      buffers_out += serialize(dgram).size();
+    }
+  }
+  const auto stop_time = steady_clock::now();
+
+  const auto test_duration = duration_cast<duration<double>>(stop_time - start_time);
+  const double datagrams_per_second
+    = static_cast<double>(rounds * datagrams.size()) / test_duration.count();
+
+  cout << "Decrementing the TTL with "
+       << (incremental ? "an incremental checksum update" : "a full checksum recomputation")
+       << " reached " << fixed << setprecision(0) << datagrams_per_second << " datagrams/s.\n";
+
+  if (buffers_out == 0) {
+    throw runtime_error("nothing was serialized");
+  }
+
+  return datagrams_per_second;
+}
+
+// Frames through a Router with two interfaces, either queued on its interface and forwarded by
+// route(), or forwarded in place by Router::recv_frame. Returns datagrams per second.
+double router_speed_test(const vector<vector<Buffer>>& datagrams, const bool fast_path)
+{
+  constexpr size_t rounds = 20;
+  constexpr size_t batch_size = 64;
+
+  Router router;
+  const size_t in_id = router.add_interface({router_in_ethernet_address, Address {"10.0.0.1"}});
+  const size_t out_id
+    = router.add_interface({router_out_ethernet_address, Address {"192.168.0.1"}});
+  router.add_route(Address {"192.168.0.0"}.ipv4_numeric(), 16, Address {"192.168.0.2"}, out_id);
+
+  // Let the outbound interface learn the next hop's Ethernet address
+  NetworkInterface next_hop {destination_ethernet_address, Address {"192.168.0.2"}};
+  router.interface(out_id).send_datagram({}, Address {"192.168.0.2"});
+  while (auto frame = router.interface(out_id).maybe_send()) {
+    next_hop.recv_frame(*frame);
+  }
+  while (auto frame = next_hop.maybe_send()) {
+    router.interface(out_id).recv_frame(*frame);
+  }
+  router.interface(out_id).maybe_send(); // the datagram that was waiting for ARP
+
+  // The fast path patches each frame in place, so give it fresh copies (made before timing)
+  vector<EthernetFrame> frames;
+  for (size_t round = 0; round < rounds; round++) {
+    for (const auto& serialized : datagrams) {
+      frames.push_back({.header = {.dst = router_in_ethernet_address,
+                                   .src = host_ethernet_address,
+                                   .type = EthernetHeader::TYPE_IPv4},
+                        .payload = {}});
+      for (const auto& buffer : serialized) {
+        frames.back().payload.emplace_back(string {buffer});
+      }
+    }
+  }
+
+  size_t forwarded = 0;
+  const auto start_time = steady_clock::now();
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (fast_path) {
+      router.recv_frame(in_id, move(frames[i]));
+    } else {
+      router.interface(in_id).recv_frame(frames[i]);
+    }
+    if (i % batch_size == batch_size - 1 or i + 1 == frames.size()) {
+      if (not fast_path) {
+        router.route();
+      }
+      while (router.interface(out_id).maybe_send()) {
+        forwarded++;
+      }
+    }
+  }
+  const auto stop_time = steady_clock::now();
+
+  if (forwarded != frames.size()) {
+    throw runtime_error("router forwarded " + to_string(forwarded) + " of "
+                        + to_string(frames.size()) + " datagrams");
+  }
+
+  const auto test_duration = duration_cast<duration<double>>(stop_time - start_time);
+  const double datagrams_per_second = static_cast<double>(forwarded) / test_duration.count();
+
+  cout << "Router forwarding " << (fast_path ? "in place" : "through route()") << " reached "
+       << fixed << setprecision(0) << datagrams_per_second << " datagrams/s.\n";
+
+  if (datagrams_per_second < 10000) {
+    throw runtime_error("router did not meet minimum speed of 10,000 datagrams/s.");
+  }
+
+  return datagrams_per_second;
+}
+
+void program_body()
+{
+  constexpr size_t num_datagrams = 10000;
+  constexpr size_t payload_size = 64;
+
+  const vector<vector<Buffer>> datagrams = make_datagrams(num_datagrams, payload_size);
+
+  const double before = header_speed_test(datagrams, false);
+  const double after = header_speed_test(datagrams, true);
+  const double routed = router_speed_test(datagrams, false);
+  const double fast = router_speed_test(datagrams, true);
+
+  fstream debug_output;
+  debug_output.open("/dev/tty");
+
+  debug_output << "      Incremental checksum on TTL decrement: " << fixed << setprecision(2)
+               << after / before << "x the rate of recomputing it\n";
+  debug_output << "             Router forwarding fast path: " << fixed << setprecision(2)
+               << fast / routed << "x the rate of route()\n";
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch (const exception& e) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
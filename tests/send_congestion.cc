@@ -0,0 +1,179 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+struct CongestionWindowAbove : public ExpectBool<StreamAndSender>
+{
+  uint64_t bound_;
+  CongestionWindowAbove(uint64_t bound, bool value) : ExpectBool(value), bound_(bound) {}
+  string name() const override { return "congestion_window > " + to_string(bound_); }
+  bool value(StreamAndSender& ss) const override
+  {
+    return ss.second.congestion_window() > bound_;
+  }
+};
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    const uint16_t window = 60000;
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test {
+        "NewReno: slow start, fast recovery and timeout", cfg, CongestionControlAlgorithm::NEWRENO};
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_syn(true).with_payload_size(0).with_seqno(isn));
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(window));
+      test.execute(ExpectCongestionWindow {10000});
+      test.execute(Push {string(20000, 'x')});
+      for (unsigned i = 0; i < 10; i++) {
+        test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 1 + 1000 * i));
+      }
+      test.execute(ExpectNoSegment {});
+      test.execute(ExpectSeqnosInFlight {10000});
+
+      // Slow start: each ACK opens the window by one segment
+      test.execute(AckReceived {Wrap32 {isn + 1001}}.with_win(window));
+      test.execute(ExpectCongestionWindow {11000});
+      test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 10001));
+      test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 11001));
+      test.execute(ExpectNoSegment {});
+
+      // Fast retransmit halves the window, then inflates it by the three duplicate ACKs
+      for (unsigned i = 0; i < 3; i++) {
+        test.execute(AckReceived {Wrap32 {isn + 1001}}.with_win(window));
+      }
+      test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 1001));
+      test.execute(ExpectNoSegment {});
+      test.execute(ExpectCongestionWindow {8500});
+
+      // Each further duplicate ACK inflates it by a segment, until new data can go out
+      for (unsigned i = 0; i < 2; i++) {
+        test.execute(AckReceived {Wrap32 {isn + 1001}}.with_win(window));
+        test.execute(ExpectNoSegment {});
+      }
+      test.execute(AckReceived {Wrap32 {isn + 1001}}.with_win(window));
+      test.execute(ExpectCongestionWindow {11500});
+      test.execute(ExpectMessage {}.with_payload_size(500).with_seqno(isn + 12001));
+      test.execute(ExpectNoSegment {});
+
+      // A partial ACK deflates the window by the data it acknowledged, less one segment, and
+      // retransmits the next hole
+      test.execute(AckReceived {Wrap32 {isn + 3001}}.with_win(window));
+      test.execute(ExpectCongestionWindow {10500});
+      test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 3001));
+      test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 12501));
+      test.execute(ExpectNoSegment {});
+
+      // Leaving recovery deflates the window to ssthresh; new data is limited by it
+      test.execute(AckReceived {Wrap32 {isn + 13501}}.with_win(window));
+      test.execute(ExpectCongestionWindow {5500});
+      test.execute(ExpectSeqnosInFlight {5500});
+      for (unsigned i = 0; i < 5; i++) {
+        test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 13501 + 1000 * i));
+      }
+      test.execute(ExpectMessage {}.with_payload_size(500).with_seqno(isn + 18501));
+      test.execute(ExpectNoSegment {});
+
+      // A timeout collapses the window to one segment
+      test.execute(Tick {TCPConfig::TIMEOUT_DFLT});
+      test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 13501));
+      test.execute(ExpectCongestionWindow {1000});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test {
+        "CUBIC: multiplicative decrease, then growth", cfg, CongestionControlAlgorithm::CUBIC};
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_syn(true).with_payload_size(0).with_seqno(isn));
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(window));
+      test.execute(Push {string(10000, 'x')});
+      for (unsigned i = 0; i < 10; i++) {
+        test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 1 + 1000 * i));
+      }
+      for (unsigned i = 0; i < 3; i++) {
+        test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(window));
+      }
+      test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 1));
+      test.execute(ExpectCongestionWindow {7000});
+      test.execute(AckReceived {Wrap32 {isn + 10001}}.with_win(window));
+      test.execute(ExpectCongestionWindow {7000});
+
+      // Congestion avoidance grows the window slowly at first, then quickly once the time
+      // needed to climb back to the window before the loss has passed
+      test.execute(Push {string(7000, 'y')});
+      for (unsigned i = 0; i < 7; i++) {
+        test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 10001 + 1000 * i));
+      }
+      test.execute(Tick {500});
+      test.execute(AckReceived {Wrap32 {isn + 17001}}.with_win(window));
+      test.execute(CongestionWindowAbove {7000, true});
+      test.execute(CongestionWindowAbove {8000, false});
+      test.execute(Tick {5000});
+      test.execute(Push {string(7000, 'z')});
+      for (unsigned i = 0; i < 7; i++) {
+        test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 17001 + 1000 * i));
+      }
+      test.execute(AckReceived {Wrap32 {isn + 24001}}.with_win(window));
+      test.execute(CongestionWindowAbove {10000, true});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test {"NewReno: only pure ACKs count as duplicate ACKs",
+                                 cfg,
+                                 CongestionControlAlgorithm::NEWRENO};
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_syn(true).with_payload_size(0).with_seqno(isn));
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(window));
+      test.execute(Push {string(10000, 'x')});
+      for (unsigned i = 0; i < 10; i++) {
+        test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 1 + 1000 * i));
+      }
+
+      // The peer is sending data of its own, and every segment repeats the same ackno
+      for (unsigned i = 0; i < 5; i++) {
+        test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(window).with_data());
+      }
+      test.execute(ExpectDuplicateAcks {0});
+      test.execute(ExpectNoSegment {});
+      test.execute(ExpectCongestionWindow {10000});
+
+      // Pure ACKs still do
+      for (unsigned i = 0; i < 2; i++) {
+        test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(window));
+      }
+      test.execute(ExpectDuplicateAcks {2});
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(window).with_data());
+      test.execute(ExpectDuplicateAcks {2});
+      test.execute(ExpectNoSegment {});
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(window));
+      test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 1));
+      test.execute(ExpectCongestionWindow {8000});
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
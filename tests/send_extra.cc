@@ -547,6 +547,43 @@ int main()
       test.execute(ExpectSeqnosInFlight {0});
       test.execute(ExpectSeqno {isn + 2 + bigstring.size()});
     }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test {"Segments follow the negotiated MSS", cfg};
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_no_flags().with_syn(true).with_seqno(isn));
+      test.execute(SetMSS {1460});
+      test.execute(AckReceived {isn + 1}.with_win(10000));
+      test.execute(Push {string(4000, 'x')});
+      test.execute(ExpectMessage {}.with_payload_size(1460).with_seqno(isn + 1));
+      test.execute(ExpectMessage {}.with_payload_size(1460).with_seqno(isn + 1461));
+      test.execute(ExpectMessage {}.with_payload_size(1080).with_seqno(isn + 2921));
+      test.execute(ExpectNoSegment {});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      const uint16_t retx_timeout = uniform_int_distribution<uint16_t> {10, 10000}(rd);
+      cfg.fixed_isn = isn;
+      cfg.rt_timeout = retx_timeout;
+
+      TCPSenderTestHarness test {"A batch holds the retransmission and then the window", cfg};
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_no_flags().with_syn(true).with_seqno(isn));
+      test.execute(AckReceived {isn + 1}.with_win(3000));
+      test.execute(Push {string(1500, 'x')});
+      test.execute(ExpectBatchPayloadSizes {{1000, 500}});
+      test.execute(ExpectBatchPayloadSizes {{}});
+      test.execute(Tick {retx_timeout});
+      test.execute(Push {string(2000, 'y')});
+      test.execute(ExpectBatchPayloadSizes {{1000, 1000, 500}});
+      test.execute(ExpectNoSegment {});
+    }
   } catch (const exception& e) {
     cerr << e.what() << endl;
     return 1;
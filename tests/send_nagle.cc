@@ -0,0 +1,145 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test {"Nagle's algorithm coalesces small writes", cfg};
+      test.execute(SetNagle {true});
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_no_flags().with_syn(true).with_seqno(isn));
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(10000));
+      // Nothing in flight, so a small write goes out at once
+      test.execute(Push {"a"});
+      test.execute(ExpectMessage {}.with_data("a").with_seqno(isn + 1));
+      // Small writes wait for the ACK
+      test.execute(Push {"b"});
+      test.execute(ExpectNoSegment {});
+      test.execute(Push {"c"});
+      test.execute(ExpectNoSegment {});
+      test.execute(AckReceived {Wrap32 {isn + 2}}.with_win(10000));
+      test.execute(ExpectMessage {}.with_data("bc").with_seqno(isn + 2));
+      // ... but never longer than the hold limit
+      test.execute(Push {"d"});
+      test.execute(ExpectNoSegment {});
+      test.execute(Tick {TCPConfig::MAX_HOLD_DFLT - 1});
+      test.execute(Push {});
+      test.execute(ExpectNoSegment {});
+      test.execute(Tick {1});
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_data("d").with_seqno(isn + 4));
+      // Full segments are not held back; the partial remainder is
+      test.execute(Push {string(1500, 'x')});
+      test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 5));
+      test.execute(ExpectNoSegment {});
+      // Closing the stream flushes it
+      test.execute(Close {});
+      test.execute(ExpectMessage {}.with_payload_size(500).with_fin(true).with_seqno(isn + 1005));
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test {"Cork holds partial segments until uncorked", cfg};
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_no_flags().with_syn(true).with_seqno(isn));
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(10000));
+      test.execute(SetCorked {true});
+      test.execute(Push {"ab"});
+      test.execute(ExpectNoSegment {});
+      test.execute(ExpectNextTimer {TCPConfig::MAX_HOLD_DFLT});
+      test.execute(Tick {50});
+      test.execute(Push {});
+      test.execute(ExpectNextTimer {TCPConfig::MAX_HOLD_DFLT - 50});
+      test.execute(Push {string(998, 'x')});
+      test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 1));
+      test.execute(Push {"cd"});
+      test.execute(ExpectNoSegment {});
+      test.execute(SetCorked {false});
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_data("cd").with_seqno(isn + 1001));
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      // TCPPeer keeps each write as its own chunk; a segment must gather them
+      TCPSenderTestHarness test {"Cork gathers many small writes into one segment",
+                                 cfg,
+                                 CongestionControlAlgorithm::NONE,
+                                 {},
+                                 ByteStream::Storage::Chunked};
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_no_flags().with_syn(true).with_seqno(isn));
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(10000));
+      test.execute(SetCorked {true});
+      for (unsigned int i = 0; i < 10; i++) {
+        test.execute(Push {string(10, static_cast<char>('a' + i))});
+        test.execute(ExpectNoSegment {});
+      }
+      test.execute(SetCorked {false});
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_payload_size(100).with_seqno(isn + 1));
+      test.execute(ExpectNoSegment {});
+      // Writes that add up to more than the MSS fill a full segment and leave the rest held back
+      test.execute(SetCorked {true});
+      for (unsigned int i = 0; i < 15; i++) {
+        test.execute(Push {string(70, 'x')});
+      }
+      test.execute(ExpectMessage {}.with_payload_size(1000).with_seqno(isn + 101));
+      test.execute(ExpectNoSegment {});
+      test.execute(SetCorked {false});
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_payload_size(50).with_seqno(isn + 1101));
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test {"Nagle's algorithm gathers small writes into one segment",
+                                 cfg,
+                                 CongestionControlAlgorithm::NONE,
+                                 {},
+                                 ByteStream::Storage::Chunked};
+      test.execute(SetNagle {true});
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_no_flags().with_syn(true).with_seqno(isn));
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(10000));
+      test.execute(Push {string(10, 'a')});
+      test.execute(ExpectMessage {}.with_payload_size(10).with_seqno(isn + 1));
+      for (unsigned int i = 0; i < 10; i++) {
+        test.execute(Push {string(10, 'b')});
+      }
+      test.execute(ExpectNoSegment {});
+      test.execute(AckReceived {Wrap32 {isn + 11}}.with_win(10000));
+      test.execute(ExpectMessage {}.with_data(string(100, 'b')).with_seqno(isn + 11));
+      test.execute(ExpectNoSegment {});
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
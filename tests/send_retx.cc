@@ -1,5 +1,6 @@
 #include "random.hh"
 #include "sender_test_harness.hh"
+#include "tcp_peer.hh"
 
 #include <cstdint>
 #include <cstdlib>
@@ -118,6 +119,161 @@ int main()
       test.execute(Tick {1}.with_max_retx_exceeded(true));
     }
 
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      const uint16_t retx_timeout = uniform_int_distribution<uint16_t> {10, 10000}(rd);
+      cfg.fixed_isn = isn;
+      cfg.rt_timeout = retx_timeout;
+
+      TCPSenderTestHarness test {"Fast retransmit on the third duplicate ACK", cfg};
+      test.execute(Push {});
+      test.execute(
+        ExpectMessage {}.with_no_flags().with_syn(true).with_payload_size(0).with_seqno(isn));
+      test.execute(AckReceived {Wrap32 {isn + 1}});
+      for (const string data : {"abcd", "efgh", "ijkl", "mnop"}) {
+        test.execute(Push {data});
+        test.execute(ExpectMessage {}.with_data(data));
+      }
+      test.execute(ExpectNoSegment {});
+      // A window update is not a duplicate ACK
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(DEFAULT_TEST_WINDOW + 1));
+      test.execute(ExpectNoSegment {});
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(DEFAULT_TEST_WINDOW + 1));
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(DEFAULT_TEST_WINDOW + 1));
+      test.execute(ExpectNoSegment {});
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(DEFAULT_TEST_WINDOW + 1));
+      test.execute(ExpectMessage {}.with_data("abcd").with_seqno(isn + 1));
+      test.execute(ExpectNoSegment {});
+      // Further duplicates do not retransmit again
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(DEFAULT_TEST_WINDOW + 1));
+      test.execute(ExpectNoSegment {});
+      // A partial ACK retransmits the next hole right away
+      test.execute(AckReceived {Wrap32 {isn + 5}}.with_win(DEFAULT_TEST_WINDOW + 1));
+      test.execute(ExpectMessage {}.with_data("efgh").with_seqno(isn + 5));
+      test.execute(ExpectNoSegment {});
+      // The RTO was not backed off
+      test.execute(Tick {retx_timeout - 1U}.with_max_retx_exceeded(false));
+      test.execute(ExpectNoSegment {});
+      test.execute(Tick {1}.with_max_retx_exceeded(false));
+      test.execute(ExpectMessage {}.with_data("efgh").with_seqno(isn + 5));
+      test.execute(AckReceived {Wrap32 {isn + 17}});
+      test.execute(ExpectSeqnosInFlight {0});
+      test.execute(ExpectNoSegment {});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test {"Adaptive RTO follows the measured RTT (Karn's rule)",
+                                 cfg,
+                                 CongestionControlAlgorithm::NONE,
+                                 RTOBounds {10, 60000}};
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_syn(true).with_payload_size(0).with_seqno(isn));
+      test.execute(ExpectRTO {TCPConfig::TIMEOUT_DFLT});
+      test.execute(Tick {100});
+      test.execute(AckReceived {Wrap32 {isn + 1}});
+      // SRTT = 100, RTTVAR = 50
+      test.execute(ExpectRTO {300});
+      test.execute(Push {"abcd"});
+      test.execute(ExpectMessage {}.with_data("abcd"));
+      test.execute(Tick {20});
+      test.execute(AckReceived {Wrap32 {isn + 5}});
+      // RTTVAR = (3 * 50 + 80) / 4 = 57, SRTT = (7 * 100 + 20) / 8 = 90
+      test.execute(ExpectRTO {318});
+      test.execute(Push {"efgh"});
+      test.execute(ExpectMessage {}.with_data("efgh"));
+      test.execute(Tick {317});
+      test.execute(ExpectNoSegment {});
+      test.execute(Tick {1});
+      test.execute(ExpectMessage {}.with_data("efgh"));
+      test.execute(ExpectRTO {636});
+      // The ACK of a retransmitted segment gives no RTT sample, but undoes the back-off
+      test.execute(Tick {600});
+      test.execute(AckReceived {Wrap32 {isn + 9}});
+      test.execute(ExpectRTO {318});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test {"Adaptive RTO stays within its bounds",
+                                 cfg,
+                                 CongestionControlAlgorithm::NONE,
+                                 RTOBounds {200, 400}};
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_syn(true).with_payload_size(0).with_seqno(isn));
+      test.execute(Tick {5});
+      test.execute(AckReceived {Wrap32 {isn + 1}});
+      test.execute(ExpectRTO {200});
+      test.execute(Push {"abcd"});
+      test.execute(ExpectMessage {}.with_data("abcd"));
+      test.execute(Tick {200});
+      test.execute(ExpectMessage {}.with_data("abcd"));
+      test.execute(ExpectRTO {400});
+      test.execute(Tick {400});
+      test.execute(ExpectMessage {}.with_data("abcd"));
+      test.execute(ExpectRTO {400});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+      cfg.rto_min = 10;
+
+      // TCPPeer keeps the lower bound at twice ack_delay, above the configured 10 ms
+      const RTOBounds bounds = TCPPeer::rto_bounds(cfg);
+      if (bounds.min_ms != 2 * cfg.ack_delay) {
+        throw runtime_error("the RTO lower bound is not clamped to twice ack_delay");
+      }
+
+      TCPSenderTestHarness test {"A delayed ACK does not trigger a retransmission",
+                                 cfg,
+                                 CongestionControlAlgorithm::NONE,
+                                 bounds};
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_syn(true).with_payload_size(0).with_seqno(isn));
+      test.execute(Tick {2});
+      test.execute(AckReceived {Wrap32 {isn + 1}});
+      // SRTT = 2 and RTTVAR = 1 would give an RTO of 6 ms, but the clamped lower bound holds
+      test.execute(ExpectRTO {2 * cfg.ack_delay});
+      test.execute(Push {"abcd"});
+      test.execute(ExpectMessage {}.with_data("abcd"));
+      // The receiver holds its ACK for the full ack_delay
+      test.execute(Tick {2 + cfg.ack_delay});
+      test.execute(ExpectNoSegment {});
+      test.execute(AckReceived {Wrap32 {isn + 5}});
+      test.execute(ExpectNoSegment {});
+      test.execute(ExpectRTO {2 * cfg.ack_delay});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      const uint16_t retx_timeout = uniform_int_distribution<uint16_t> {10, 10000}(rd);
+      cfg.fixed_isn = isn;
+      cfg.rt_timeout = retx_timeout;
+
+      TCPSenderTestHarness test {"Next timer deadline follows the retransmission timer", cfg};
+      test.execute(ExpectNextTimer {ExpectNextTimer::NONE});
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_syn(true).with_payload_size(0).with_seqno(isn));
+      test.execute(ExpectNextTimer {retx_timeout});
+      test.execute(Tick {retx_timeout - 3U});
+      test.execute(ExpectNextTimer {3});
+      test.execute(Tick {3});
+      test.execute(ExpectMessage {}.with_syn(true).with_payload_size(0).with_seqno(isn));
+      test.execute(ExpectNextTimer {2 * uint64_t {retx_timeout}});
+      test.execute(AckReceived {Wrap32 {isn + 1}});
+      test.execute(ExpectNextTimer {ExpectNextTimer::NONE});
+    }
+
   } catch (const exception& e) {
     cerr << e.what() << endl;
     return 1;
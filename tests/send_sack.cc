@@ -0,0 +1,79 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test {"Retransmit a segment once three later ones are SACKed", cfg};
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_no_flags().with_syn(true).with_seqno(isn));
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(1000));
+      for (const string data : {"aaaa", "bbbb", "cccc", "dddd", "eeee"}) {
+        test.execute(Push {data});
+        test.execute(ExpectMessage {}.with_no_flags().with_data(data));
+      }
+      test.execute(ExpectSeqnosInFlight {20});
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(1000).with_sack(isn + 5, isn + 9));
+      test.execute(ExpectSegmentsPresumedLost {0});
+      test.execute(ExpectNoSegment {});
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(1000).with_sack(isn + 5, isn + 13));
+      test.execute(ExpectSegmentsPresumedLost {0});
+      test.execute(ExpectNoSegment {});
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(1000).with_sack(isn + 5, isn + 17));
+      test.execute(ExpectSegmentsPresumedLost {1});
+      test.execute(ExpectMessage {}.with_no_flags().with_data("aaaa").with_seqno(isn + 1));
+      test.execute(ExpectSegmentsPresumedLost {0});
+      test.execute(ExpectNoSegment {});
+      // Retransmitted segments are not resent on later SACKs
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(1000).with_sack(isn + 5, isn + 21));
+      test.execute(ExpectNoSegment {});
+      test.execute(AckReceived {Wrap32 {isn + 21}}.with_win(1000));
+      test.execute(ExpectSeqnosInFlight {0});
+      test.execute(ExpectNoSegment {});
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn(rd());
+      const uint16_t retx_timeout = uniform_int_distribution<uint16_t> {10, 10000}(rd);
+      cfg.fixed_isn = isn;
+      cfg.rt_timeout = retx_timeout;
+
+      TCPSenderTestHarness test {"Timeout skips segments the receiver has SACKed", cfg};
+      test.execute(Push {});
+      test.execute(ExpectMessage {}.with_no_flags().with_syn(true).with_seqno(isn));
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(1000));
+      for (const string data : {"aaaa", "bbbb", "cccc"}) {
+        test.execute(Push {data});
+        test.execute(ExpectMessage {}.with_no_flags().with_data(data));
+      }
+      test.execute(AckReceived {Wrap32 {isn + 1}}.with_win(1000).with_sack(isn + 1, isn + 5));
+      test.execute(ExpectSegmentsPresumedLost {0});
+      test.execute(Tick {retx_timeout});
+      test.execute(ExpectMessage {}.with_no_flags().with_data("bbbb").with_seqno(isn + 5));
+      test.execute(ExpectNoSegment {});
+      test.execute(AckReceived {Wrap32 {isn + 13}}.with_win(1000));
+      test.execute(ExpectSeqnosInFlight {0});
+    }
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
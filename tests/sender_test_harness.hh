@@ -9,6 +9,7 @@
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 const unsigned int DEFAULT_TEST_WINDOW = 137;
 
@@ -57,6 +58,75 @@ struct ExpectSeqnosInFlight : public ExpectNumber<StreamAndSender, uint64_t>
   }
 };
 
+struct ExpectSegmentsPresumedLost : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "segments_presumed_lost"; }
+  uint64_t value(StreamAndSender& ss) const override { return ss.second.segments_presumed_lost(); }
+};
+
+struct ExpectCongestionWindow : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "congestion_window"; }
+  uint64_t value(StreamAndSender& ss) const override { return ss.second.congestion_window(); }
+};
+
+struct ExpectDuplicateAcks : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "duplicate_acks"; }
+  uint64_t value(StreamAndSender& ss) const override { return ss.second.duplicate_acks(); }
+};
+
+struct ExpectRTO : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "current_RTO_ms"; }
+  uint64_t value(StreamAndSender& ss) const override { return ss.second.current_RTO_ms(); }
+};
+
+struct ExpectNextTimer : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  static constexpr uint64_t NONE = UINT64_MAX;
+
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "ms_until_next_timer (or NONE)"; }
+  uint64_t value(StreamAndSender& ss) const override
+  {
+    return ss.second.ms_until_next_timer().value_or(NONE);
+  }
+};
+
+struct ExpectBatchPayloadSizes : public Expectation<StreamAndSender>
+{
+  std::vector<size_t> sizes_;
+
+  explicit ExpectBatchPayloadSizes(std::vector<size_t> sizes) : sizes_(std::move(sizes)) {}
+  std::string description() const override
+  {
+    std::ostringstream o;
+    o << "batch of " << sizes_.size() << " messages with payload sizes";
+    for (const auto size : sizes_) {
+      o << " " << size;
+    }
+    return o.str();
+  }
+  void execute(StreamAndSender& ss) const override
+  {
+    std::vector<TCPSenderMessage> batch;
+    ss.second.maybe_send(batch);
+    if (batch.size() != sizes_.size()) {
+      throw ExpectationViolation("batch size", sizes_.size(), batch.size());
+    }
+    for (size_t i = 0; i < batch.size(); i++) {
+      if (batch[i].payload.size() != sizes_[i]) {
+        throw ExpectationViolation("payload_size", sizes_[i], batch[i].payload.size());
+      }
+    }
+  }
+};
+
 struct ExpectNoSegment : public Expectation<StreamAndSender>
 {
   std::string description() const override { return "nothing to send"; }
@@ -155,27 +225,41 @@ struct Receive : public Action<StreamAndSender>
 {
   TCPReceiverMessage msg_;
   bool push_ = true;
+  bool pure_ack_ = true;
 
   explicit Receive(TCPReceiverMessage msg) : msg_(msg) {}
   std::string description() const override
   {
     std::ostringstream desc;
-    desc << "receive(ack=" << to_string(msg_.ackno) << ", win=" << msg_.window_size << ")";
+    desc << "receive(ack=" << to_string(msg_.ackno) << ", win=" << msg_.window_size;
+    for (const auto& [left, right] : msg_.sack_blocks) {
+      desc << ", sack=[" << left << ", " << right << ")";
+    }
+    desc << ")";
+    if (not pure_ack_) {
+      desc << " on a segment carrying data";
+    }
     if (push_) {
       desc << ", then push stream to TCPSender";
     }
     return desc.str();
   }
 
-  Receive& with_win(uint16_t win)
+  Receive& with_win(uint32_t win)
   {
     msg_.window_size = win;
     return *this;
   }
 
+  Receive& with_sack(Wrap32 left, Wrap32 right)
+  {
+    msg_.sack_blocks.emplace_back(left, right);
+    return *this;
+  }
+
   void execute(StreamAndSender& ss) const override
   {
-    ss.second.receive(msg_);
+    ss.second.receive(msg_, pure_ack_);
     if (push_) {
       ss.second.push(ss.first.reader());
     }
@@ -186,6 +270,12 @@ struct Receive : public Action<StreamAndSender>
     push_ = false;
     return *this;
   }
+
+  Receive& with_data()
+  {
+    pure_ack_ = false;
+    return *this;
+  }
 };
 
 struct AckReceived : public Receive
@@ -193,6 +283,36 @@ struct AckReceived : public Receive
   explicit AckReceived(Wrap32 ackno) : Receive({ackno, DEFAULT_TEST_WINDOW}) {}
 };
 
+struct SetMSS : public Action<StreamAndSender>
+{
+  uint64_t mss_;
+
+  explicit SetMSS(uint64_t mss) : mss_(mss) {}
+  std::string description() const override { return "set MSS to " + std::to_string(mss_); }
+  void execute(StreamAndSender& ss) const override { ss.second.set_mss(mss_); }
+};
+
+struct SetNagle : public Action<StreamAndSender>
+{
+  bool enabled_;
+
+  explicit SetNagle(bool enabled) : enabled_(enabled) {}
+  std::string description() const override
+  {
+    return std::string(enabled_ ? "enable" : "disable") + " Nagle's algorithm";
+  }
+  void execute(StreamAndSender& ss) const override { ss.second.set_nagle(enabled_); }
+};
+
+struct SetCorked : public Action<StreamAndSender>
+{
+  bool corked_;
+
+  explicit SetCorked(bool corked) : corked_(corked) {}
+  std::string description() const override { return corked_ ? "cork" : "uncork"; }
+  void execute(StreamAndSender& ss) const override { ss.second.set_corked(corked_); }
+};
+
 struct Close : public Push
 {
   Close() : Push("") { with_close(); }
@@ -297,7 +417,7 @@ struct ExpectMessage : public Expectation<StreamAndSender>
     if (payload_size.has_value() and seg.payload.size() != payload_size.value()) {
       throw ExpectationViolation("payload_size", payload_size.value(), seg.payload.size());
     }
-    if (seg.payload.size() > TCPConfig::MAX_PAYLOAD_SIZE) {
+    if (seg.payload.size() > ss.second.mss()) {
       throw ExpectationViolation("payload has length (" + std::to_string(seg.payload.size())
                                  + ") greater than the maximum");
     }
@@ -312,10 +432,17 @@ struct ExpectMessage : public Expectation<StreamAndSender>
 class TCPSenderTestHarness : public TestHarness<StreamAndSender>
 {
 public:
-  TCPSenderTestHarness(std::string name, TCPConfig config)
-    : TestHarness(
-      move(name),
-      "initial_RTO_ms=" + to_string(config.rt_timeout),
-      {ByteStream {config.send_capacity}, TCPSender {config.rt_timeout, config.fixed_isn}})
+  // The window and timer tests exercise the receiver's window and a fixed RTO alone, so
+  // congestion control and the adaptive RTO are opt-in. TCPPeer's outbound stream is Chunked.
+  TCPSenderTestHarness(std::string name,
+                       TCPConfig config,
+                       CongestionControlAlgorithm cc = CongestionControlAlgorithm::NONE,
+                       std::optional<RTOBounds> rto_bounds = {},
+                       ByteStream::Storage storage = ByteStream::Storage::Ring)
+    : TestHarness(move(name),
+                  "initial_RTO_ms=" + to_string(config.rt_timeout)
+                    + (storage == ByteStream::Storage::Chunked ? ", chunked stream" : ""),
+                  {ByteStream {config.send_capacity, storage},
+                   TCPSender {config.rt_timeout, config.fixed_isn, cc, rto_bounds}})
   {}
 };
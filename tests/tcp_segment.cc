@@ -0,0 +1,60 @@
+#include "tcp_segment.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+size_t serialized_length(const TCPSegment& seg)
+{
+  size_t length = 0;
+  for (const auto& buf : serialize(seg)) {
+    length += string_view {buf}.size();
+  }
+  return length;
+}
+
+// header_length() computes the length of the options; it must match what serialize() writes, for
+// every combination of options and up to more SACK blocks than fit
+void header_length_matches_serialize()
+{
+  for (unsigned int syn_options = 0; syn_options < 8; syn_options++) {
+    for (uint32_t num_blocks = 0; num_blocks <= 5; num_blocks++) {
+      TCPSegment seg;
+      if (syn_options & 1) {
+        seg.mss = 1460;
+      }
+      seg.sack_permitted = syn_options & 2;
+      if (syn_options & 4) {
+        seg.window_scale = 7;
+      }
+      for (uint32_t i = 0; i < num_blocks; i++) {
+        seg.receiver_message.sack_blocks.emplace_back(Wrap32 {100 * i}, Wrap32 {100 * i + 50});
+      }
+      seg.sender_message.payload = string(123, 'x');
+
+      test_should_be(seg.header_length(),
+                     serialized_length(seg) - seg.sender_message.payload.size());
+    }
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    header_length_matches_serialize();
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+#include "random.hh"
+#include "test_should_be.hh"
+#include "timer_wheel.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Deadlines of the timers that fired, in the order they did
+using Fired = vector<uint64_t>;
+
+string str(const Fired& fired)
+{
+  string out = "{";
+  for (const uint64_t deadline : fired) {
+    out += " " + to_string(deadline);
+  }
+  return out + " }";
+}
+
+void expect_fired(const Fired& actual, const Fired& expected)
+{
+  if (actual != expected) {
+    throw runtime_error("timers with deadlines " + str(expected) + " should have fired, but "
+                        + str(actual) + " did");
+  }
+}
+
+TimerWheel::TimerId schedule(TimerWheel& wheel, Fired& fired, uint64_t deadline)
+{
+  return wheel.schedule(deadline, [&fired, deadline] { fired.push_back(deadline); });
+}
+
+// Advance to one before `deadline` (nothing fires), then to `deadline` (exactly that timer fires)
+void expect_fires_at(TimerWheel& wheel, Fired& fired, uint64_t deadline)
+{
+  test_should_be(wheel.next_deadline().value_or(UINT64_MAX), deadline);
+  fired.clear();
+  test_should_be(wheel.advance_to(deadline - 1), size_t {0});
+  expect_fired(fired, {});
+  test_should_be(wheel.advance_to(deadline), size_t {1});
+  expect_fired(fired, Fired {deadline});
+}
+
+void cascade_through_every_level()
+{
+  TimerWheel wheel {1'000'003};
+  Fired fired;
+  const uint64_t now = wheel.now_ms();
+
+  // One timer per level (each deadline first differs from now in 6-bit digit 0, 1, 2 and 3), and
+  // two beyond the last level that wait in the overflow list
+  const vector<uint64_t> deadlines {now + 5,
+                                    now + 100,
+                                    now + 5'000,
+                                    now + 300'000,
+                                    now + (uint64_t {1} << 24) + 7,
+                                    now + (uint64_t {1} << 26)};
+  for (auto it = deadlines.rbegin(); it != deadlines.rend(); ++it) {
+    schedule(wheel, fired, *it);
+  }
+
+  for (const uint64_t deadline : deadlines) {
+    expect_fires_at(wheel, fired, deadline);
+  }
+  test_should_be(wheel.empty(), true);
+  test_should_be(wheel.next_deadline().has_value(), false);
+}
+
+void cancel()
+{
+  TimerWheel wheel;
+  Fired fired;
+
+  const auto early = schedule(wheel, fired, 10);
+  schedule(wheel, fired, 10);
+  const auto far = schedule(wheel, fired, 70'000);
+  schedule(wheel, fired, 80'000);
+  const auto overflow = schedule(wheel, fired, uint64_t {1} << 25);
+
+  // A cancelled timer no longer counts for next_deadline, even with another one in its slot
+  wheel.cancel(early);
+  test_should_be(wheel.next_deadline().value_or(UINT64_MAX), uint64_t {10});
+  test_should_be(wheel.advance_to(10), size_t {1});
+
+  // Cancelled timers on a higher level and in the overflow list are dropped when they would cascade
+  wheel.cancel(far);
+  wheel.cancel(overflow);
+  expect_fires_at(wheel, fired, 80'000);
+  test_should_be(wheel.empty(), true);
+  test_should_be(wheel.advance_to(uint64_t {1} << 26), size_t {0});
+
+  // Cancelling a timer that already fired does nothing
+  wheel.cancel(early);
+  test_should_be(wheel.empty(), true);
+}
+
+void past_and_nested()
+{
+  TimerWheel wheel {500};
+  Fired fired;
+
+  // A deadline that has already passed fires on the next advance, even one to the current time
+  schedule(wheel, fired, 100);
+  test_should_be(wheel.next_deadline().value_or(UINT64_MAX), uint64_t {100});
+  test_should_be(wheel.advance_to(500), size_t {1});
+  expect_fired(fired, Fired {100});
+
+  // A callback may schedule another timer; one that is already due fires in the same advance
+  fired.clear();
+  wheel.schedule(600, [&] {
+    fired.push_back(600);
+    schedule(wheel, fired, 600);
+    schedule(wheel, fired, 700);
+  });
+  test_should_be(wheel.advance_to(650), size_t {2});
+  expect_fired(fired, Fired {600, 600});
+  expect_fires_at(wheel, fired, 700);
+}
+
+// Compare with a plain ordered list of deadlines, over random schedules, cancels and advances
+void random_against_model()
+{
+  auto rd = get_random_engine();
+  TimerWheel wheel {uniform_int_distribution<uint64_t> {0, uint64_t {1} << 40}(rd)};
+  Fired fired;
+  multimap<uint64_t, TimerWheel::TimerId> model;
+
+  for (unsigned int round = 0; round < 1000; round++) {
+    for (unsigned int i = uniform_int_distribution<unsigned int> {0, 4}(rd); i > 0; i--) {
+      const unsigned int bits = uniform_int_distribution<unsigned int> {0, 25}(rd);
+      const uint64_t delay = uniform_int_distribution<uint64_t> {0, uint64_t {1} << bits}(rd);
+      const uint64_t deadline = wheel.now_ms() + delay;
+      model.emplace(deadline, schedule(wheel, fired, deadline));
+    }
+    if (not model.empty() and uniform_int_distribution<unsigned int> {0, 3}(rd) == 0) {
+      auto victim = model.begin();
+      advance(victim, uniform_int_distribution<size_t> {0, model.size() - 1}(rd));
+      wheel.cancel(victim->second);
+      model.erase(victim);
+    }
+
+    test_should_be(wheel.next_deadline().value_or(UINT64_MAX),
+                   model.empty() ? UINT64_MAX : model.begin()->first);
+
+    const unsigned int bits = uniform_int_distribution<unsigned int> {0, 22}(rd);
+    const uint64_t target
+      = wheel.now_ms() + uniform_int_distribution<uint64_t> {0, uint64_t {1} << bits}(rd);
+    Fired expected;
+    while (not model.empty() and model.begin()->first <= target) {
+      expected.push_back(model.begin()->first);
+      model.erase(model.begin());
+    }
+
+    fired.clear();
+    test_should_be(wheel.advance_to(target), expected.size());
+    expect_fired(fired, expected);
+    test_should_be(wheel.now_ms(), target);
+    test_should_be(wheel.empty(), model.empty());
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    cascade_through_every_level();
+    cancel();
+    past_and_nested();
+    random_against_model();
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -20,4 +20,5 @@ public:
   size_t size() const { return buffer_->size(); }
   size_t length() const { return buffer_->length(); }
   bool empty() const { return buffer_->empty(); }
+  bool sole_owner() const { return buffer_.use_count() == 1; }
 };
@@ -0,0 +1,168 @@
+#include "checksum.hh"
+
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Each kernel returns a sum of the data's 16-bit words in native byte order, congruent (mod 0xffff)
+// to the one's complement sum and nonzero unless every byte is zero. A trailing odd byte is summed
+// as if followed by a zero byte. (RFC 1071 section 2: the sum is independent of byte order, up to
+// a final swap.)
+using KernelFunction = uint64_t (*)(const uint8_t* data, size_t len);
+
+uint64_t fold64(uint64_t sum)
+{
+  sum = (sum >> 32) + (sum & 0xffffffff);
+  sum = (sum >> 32) + (sum & 0xffffffff);
+  sum = (sum >> 16) + (sum & 0xffff);
+  sum = (sum >> 16) + (sum & 0xffff);
+  return sum;
+}
+
+// Sum a run of fewer than 8 bytes as one zero-padded 64-bit word
+uint64_t tail_word(const uint8_t* data, size_t len)
+{
+  uint64_t word = 0;
+  memcpy(&word, data, len);
+  return word;
+}
+
+uint64_t sum_words(const uint8_t* data, size_t len)
+{
+  uint64_t sum = 0;
+  uint64_t carries = 0;
+  while (len >= 8) {
+    uint64_t word {};
+    memcpy(&word, data, 8);
+    sum += word;
+    carries += sum < word;
+    data += 8;
+    len -= 8;
+  }
+  const uint64_t tail = tail_word(data, len);
+  sum += tail;
+  carries += sum < tail;
+
+  // each carry out of bit 63 is worth 2^64, which is 1 mod 0xffff
+  return fold64(fold64(sum) + carries);
+}
+
+#if defined(__x86_64__)
+// Zero-extend 32-bit words to 64-bit lanes, so no carries are lost
+__attribute__((target("sse2"))) uint64_t sum_sse2(const uint8_t* data, size_t len)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum_a = zero;
+  __m128i sum_b = zero;
+  while (len >= 16) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)); // NOLINT
+    sum_a = _mm_add_epi64(sum_a, _mm_unpacklo_epi32(v, zero));
+    sum_b = _mm_add_epi64(sum_b, _mm_unpackhi_epi32(v, zero));
+    data += 16;
+    len -= 16;
+  }
+  const __m128i sum = _mm_add_epi64(sum_a, sum_b);
+  uint64_t vector_sum = 0;
+  vector_sum += fold64(static_cast<uint64_t>(_mm_cvtsi128_si64(sum)));
+  vector_sum += fold64(static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(sum, sum))));
+  return fold64(vector_sum + sum_words(data, len));
+}
+
+__attribute__((target("avx2"))) uint64_t sum_avx2(const uint8_t* data, size_t len)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i sum_a = zero;
+  __m256i sum_b = zero;
+  while (len >= 32) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)); // NOLINT
+    sum_a = _mm256_add_epi64(sum_a, _mm256_unpacklo_epi32(v, zero));
+    sum_b = _mm256_add_epi64(sum_b, _mm256_unpackhi_epi32(v, zero));
+    data += 32;
+    len -= 32;
+  }
+  const __m256i sum = _mm256_add_epi64(sum_a, sum_b);
+  uint64_t vector_sum = 0;
+  vector_sum += fold64(static_cast<uint64_t>(_mm256_extract_epi64(sum, 0)));
+  vector_sum += fold64(static_cast<uint64_t>(_mm256_extract_epi64(sum, 1)));
+  vector_sum += fold64(static_cast<uint64_t>(_mm256_extract_epi64(sum, 2)));
+  vector_sum += fold64(static_cast<uint64_t>(_mm256_extract_epi64(sum, 3)));
+  return fold64(vector_sum + sum_words(data, len));
+}
+#endif
+
+KernelFunction kernel_function(InternetChecksum::Kernel kernel)
+{
+  switch (kernel) {
+#if defined(__x86_64__)
+    case InternetChecksum::Kernel::SSE2:
+      return sum_sse2;
+    case InternetChecksum::Kernel::AVX2:
+      return sum_avx2;
+#endif
+    default:
+      return sum_words;
+  }
+}
+
+} // namespace
+
+bool InternetChecksum::supported(Kernel kernel)
+{
+  switch (kernel) {
+    case Kernel::BYTEWISE:
+    case Kernel::WORDS:
+      return true;
+#if defined(__x86_64__)
+    case Kernel::SSE2:
+      return __builtin_cpu_supports("sse2");
+    case Kernel::AVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+InternetChecksum::Kernel InternetChecksum::fastest_kernel()
+{
+  static const Kernel fastest = supported(Kernel::AVX2)   ? Kernel::AVX2
+                                : supported(Kernel::SSE2) ? Kernel::SSE2
+                                                          : Kernel::WORDS;
+  return fastest;
+}
+
+void InternetChecksum::add(string_view data, Kernel kernel)
+{
+  if (kernel == Kernel::BYTEWISE) {
+    for (const uint8_t i : data) {
+      uint16_t val = i;
+      if (not parity_) {
+        val <<= 8;
+      }
+      sum_ += val;
+      parity_ = !parity_;
+    }
+    return;
+  }
+
+  const auto* bytes = reinterpret_cast<const uint8_t*>(data.data()); // NOLINT
+  uint32_t partial = kernel_function(kernel)(bytes, data.size());
+
+  // The kernels sum in native byte order, and data that starts at an odd offset lands in the
+  // opposite halves of each 16-bit word; either way a byte swap of the folded sum corrects it.
+  if ((endian::native == endian::little) != parity_) {
+    partial = static_cast<uint16_t>((partial << 8) | (partial >> 8));
+  }
+
+  // Fold as we go so the running sum cannot overflow
+  sum_ += partial;
+  sum_ = (sum_ >> 16) + (sum_ & 0xffff);
+  parity_ ^= data.size() % 2 == 1;
+}
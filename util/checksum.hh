@@ -9,23 +9,31 @@
 //! The internet checksum algorithm
 class InternetChecksum
 {
+public:
+  //! Ways of summing a run of bytes; every kernel produces the same checksum
+  enum class Kernel
+  {
+    BYTEWISE, // one byte at a time
+    WORDS,    // 64-bit words with carry folding
+    SSE2,     // 128-bit vectors
+    AVX2,     // 256-bit vectors
+  };
+
+  //! Whether this CPU can run `kernel`
+  static bool supported(Kernel kernel);
+
+  //! The fastest kernel this CPU supports (chosen once, at first use)
+  static Kernel fastest_kernel();
+
 private:
   uint32_t sum_;
   bool parity_ {};
 
 public:
   explicit InternetChecksum(const uint32_t sum = 0) : sum_(sum) {}
-  void add(std::string_view data)
-  {
-    for (const uint8_t i : data) {
-      uint16_t val = i;
-      if (not parity_) {
-        val <<= 8;
-      }
-      sum_ += val;
-      parity_ = !parity_;
-    }
-  }
+
+  void add(std::string_view data, Kernel kernel);
+  void add(std::string_view data) { add(data, fastest_kernel()); }
 
   uint16_t value() const
   {
@@ -38,6 +46,21 @@ public:
     return ~ret;
   }
 
+  //! The checksum after one 16-bit word that it covers changes from `old_word` to `new_word`,
+  //! computed from the old checksum alone (RFC 1624 equation 3)
+  static uint16_t update(const uint16_t checksum, const uint16_t old_word, const uint16_t new_word)
+  {
+    uint32_t sum = static_cast<uint16_t>(~checksum);
+    sum += static_cast<uint16_t>(~old_word);
+    sum += new_word;
+
+    while (sum > 0xffff) {
+      sum = (sum >> 16) + static_cast<uint16_t>(sum);
+    }
+
+    return ~sum;
+  }
+
   void add(const std::vector<Buffer>& data)
   {
     for (const auto& x : data) {
@@ -2,12 +2,57 @@
 #include "exception.hh"
 #include "socket.hh"
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <sys/epoll.h>
 
 using namespace std;
 
+// NOLINTBEGIN(*-signed-bitwise)
+// The pollfd event bits double as epoll event bits
+static_assert( POLLIN == EPOLLIN and POLLOUT == EPOLLOUT and POLLERR == EPOLLERR and POLLHUP == EPOLLHUP );
+// NOLINTEND(*-signed-bitwise)
+
+EventLoop::EventLoop( const Backend backend, const Dispatch dispatch ) : _backend( backend ), _dispatch( dispatch )
+{
+  _rule_categories.reserve( 64 );
+  if ( _backend == Backend::Epoll ) {
+    _epoll.emplace( CheckSystemCall( "epoll_create1", ::epoll_create1( EPOLL_CLOEXEC ) ) );
+  }
+}
+
+uint64_t EventLoop::now_ms()
+{
+  return chrono::duration_cast<chrono::milliseconds>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+TimerWheel::TimerId EventLoop::add_timer( const uint64_t deadline_ms, const CallbackT& callback )
+{
+  // The wheel places a deadline correctly however far its clock lags, so leave the clock alone here:
+  // advancing it would run the callbacks of due timers inside add_timer(), which may itself be called
+  // from a callback. Due timers run only in wait_next_event().
+  return _timers.schedule( deadline_ms, callback );
+}
+
+int EventLoop::wait_timeout( const int timeout_ms ) const
+{
+  const auto deadline = _timers.next_deadline();
+  if ( not deadline.has_value() ) {
+    return timeout_ms;
+  }
+
+  const uint64_t now = now_ms();
+  const uint64_t until_deadline = deadline.value() > now ? deadline.value() - now : 0;
+  if ( timeout_ms >= 0 and static_cast<uint64_t>( timeout_ms ) <= until_deadline ) {
+    return timeout_ms;
+  }
+  return static_cast<int>( min<uint64_t>( until_deadline, INT_MAX ) );
+}
+
 unsigned int EventLoop::FDRule::service_count() const
 {
   return direction == Direction::In ? fd.read_count() : fd.write_count();
@@ -53,6 +98,11 @@ EventLoop::RuleHandle EventLoop::add_rule( size_t category_id,
 
   _fd_rules.emplace_back( make_shared<FDRule>(
     BasicRule { category_id, interest, callback }, fd.duplicate(), direction, cancel, recover ) );
+  _fd_rules.back()->order = _next_rule_order++;
+
+  if ( _backend == Backend::Epoll ) {
+    epoll_attach( *_fd_rules.back() );
+  }
 
   return RuleHandle { _fd_rules.back() };
 }
@@ -78,11 +128,81 @@ void EventLoop::RuleHandle::cancel()
   }
 }
 
-// NOLINTBEGIN(*-cognitive-complexity)
-// NOLINTBEGIN(*-signed-bitwise)
+// Register the rule's fd with epoll (once per FileDescriptor handle), initially with no interests; the
+// first wait_next_event() asks for the rule's direction if the rule is interested. Keying on the handle
+// rather than the fd number keeps a number the kernel reused for a new file from matching the stale
+// registration of a closed one.
+void EventLoop::epoll_attach( FDRule& rule )
+{
+  auto& entry = _epoll_fds[rule.fd.handle()];
+  if ( not entry ) {
+    entry = make_shared<EpollFD>( EpollFD { rule.fd.handle(), rule.fd.fd_num() } );
+    epoll_event event {};
+    event.data.ptr = entry.get();
+    CheckSystemCall( "epoll_ctl", ::epoll_ctl( _epoll->fd_num(), EPOLL_CTL_ADD, entry->fd_num, &event ) );
+  }
+  entry->rules.push_back( &rule );
+  rule.epoll_fd = entry;
+}
+
+void EventLoop::epoll_detach( FDRule& rule )
+{
+  const shared_ptr<EpollFD> entry = move( rule.epoll_fd );
+  if ( not entry ) {
+    return;
+  }
+
+  erase( entry->rules, &rule );
+  if ( entry->rules.empty() ) {
+    // Closing the fd already took it out of the epoll set, and its number may now belong to another
+    // registration, so only an open fd is deleted
+    if ( not rule.fd.closed() ) {
+      ::epoll_ctl( _epoll->fd_num(), EPOLL_CTL_DEL, entry->fd_num, nullptr );
+    }
+    _epoll_fds.erase( entry->handle );
+  } else if ( rule.interested ) {
+    _epoll_dirty.push_back( entry );
+  }
+}
+
+// Apply the interests that changed since the last wait to the epoll set
+void EventLoop::epoll_update_interests()
+{
+  for ( const auto& entry : _epoll_dirty ) {
+    if ( entry->rules.empty() ) {
+      continue; // detached since it was marked
+    }
+
+    uint32_t events = 0;
+    for ( const auto* rule : entry->rules ) {
+      if ( rule->interested ) {
+        events |= static_cast<uint32_t>( rule->direction ); // NOLINT(*-signed-bitwise)
+      }
+    }
+
+    if ( events != entry->registered_events ) {
+      epoll_event event {};
+      event.events = events;
+      event.data.ptr = entry.get();
+      CheckSystemCall( "epoll_ctl", ::epoll_ctl( _epoll->fd_num(), EPOLL_CTL_MOD, entry->fd_num, &event ) );
+      entry->registered_events = events;
+    }
+  }
+  _epoll_dirty.clear();
+}
+
+list<shared_ptr<EventLoop::FDRule>>::iterator EventLoop::erase_fd_rule( list<shared_ptr<FDRule>>::iterator it )
+{
+  if ( _backend == Backend::Epoll ) {
+    epoll_detach( **it );
+  }
+  return _fd_rules.erase( it );
+}
+
 EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
 {
   // first, handle the non-file-descriptor-related rules
+  bool non_fd_rule_fired = false;
   {
     for ( auto it = _non_fd_rules.begin(); it != _non_fd_rules.end(); ) {
       auto& this_rule = **it;
@@ -106,14 +226,26 @@ EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
       }
 
       if ( rule_fired ) {
-        return Result::Success; /* only serve one rule on each iteration */
+        if ( _dispatch == Dispatch::OneRule ) {
+          return Result::Success; /* only serve one rule on each iteration */
+        }
+        non_fd_rule_fired = true;
       }
 
       ++it;
     }
   }
 
-  // now the file-descriptor-related rules. poll any "interested" file descriptors
+  // now the file-descriptor-related rules; if a rule already ran, only take the fds that are ready now
+  const int fd_timeout_ms = non_fd_rule_fired ? 0 : timeout_ms;
+  const Result result = _backend == Backend::Epoll ? wait_epoll( fd_timeout_ms ) : wait_poll( fd_timeout_ms );
+  return non_fd_rule_fired ? Result::Success : result;
+}
+
+// NOLINTBEGIN(*-signed-bitwise)
+EventLoop::Result EventLoop::wait_poll( const int timeout_ms )
+{
+  // poll any "interested" file descriptors
   vector<pollfd> pollfds {};
   pollfds.reserve( _fd_rules.size() );
   bool something_to_poll = false;
@@ -126,24 +258,25 @@ EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
       //      this_rule.cancel();
       //      if rule is cancelled externally, no need to call the cancellation callback
       //      this makes it easier to cancel rules and delete captured objects right away
-      it = _fd_rules.erase( it );
+      it = erase_fd_rule( it );
       continue;
     }
 
     if ( this_rule.direction == Direction::In && this_rule.fd.eof() ) {
       // no more reading on this rule, it's reached eof
       this_rule.cancel();
-      it = _fd_rules.erase( it );
+      it = erase_fd_rule( it );
       continue;
     }
 
     if ( this_rule.fd.closed() ) {
       this_rule.cancel();
-      it = _fd_rules.erase( it );
+      it = erase_fd_rule( it );
       continue;
     }
 
-    if ( this_rule.interest() ) {
+    this_rule.interested = this_rule.interest();
+    if ( this_rule.interested ) {
       pollfds.push_back( { this_rule.fd.fd_num(), static_cast<int16_t>( this_rule.direction ), 0 } );
       something_to_poll = true;
     } else {
@@ -152,82 +285,198 @@ EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
     ++it;
   }
 
-  // quit if there is nothing left to poll
-  if ( not something_to_poll ) {
+  // quit if there is nothing left to poll or wait for
+  if ( not something_to_poll and _timers.empty() ) {
     return Result::Exit;
   }
 
   // call poll -- wait until one of the fds satisfies one of the rules (writeable/readable)
-  if ( 0 == CheckSystemCall( "poll", ::poll( pollfds.data(), pollfds.size(), timeout_ms ) ) ) {
-    return Result::Timeout;
+  const int ready = CheckSystemCall( "poll", ::poll( pollfds.data(), pollfds.size(), wait_timeout( timeout_ms ) ) );
+  const bool timers_fired = _timers.advance_to( now_ms() ) > 0;
+  if ( ready == 0 ) {
+    return timers_fired ? Result::Success : Result::Timeout;
   }
 
-  // go through the poll results
-  for ( auto [it, idx] = make_pair( _fd_rules.begin(), static_cast<size_t>( 0 ) ); it != _fd_rules.end(); ++idx ) {
-    const auto& this_pollfd = pollfds.at( idx );
+  // go through the poll results (rules added by callbacks on the way weren't polled, so stop before them)
+  bool served = false;
+  for ( auto [it, idx] = make_pair( _fd_rules.begin(), static_cast<size_t>( 0 ) );
+        it != _fd_rules.end() and idx < pollfds.size();
+        ++idx ) {
     auto& this_rule = **it;
+    const auto& this_pollfd = pollfds.at( idx );
+    if ( this_rule.cancel_requested ) { // cancelled by a callback in this pass
+      ++it;
+      continue;
+    }
 
-    const auto poll_error = static_cast<bool>( this_pollfd.revents & ( POLLERR | POLLNVAL ) );
-    if ( poll_error ) {
-      /* recoverable error? */
-      if ( not static_cast<bool>( this_pollfd.revents & POLLNVAL ) ) {
-        if ( this_rule.recover() ) {
-          ++it;
-          continue;
+    auto events = static_cast<uint16_t>( this_pollfd.events );
+    if ( served and events != 0 and not this_rule.interest() ) {
+      events = 0; // an earlier callback in this pass took away the rule's interest
+    }
+    switch ( serve_fd_rule( this_rule, events, static_cast<uint16_t>( this_pollfd.revents ) ) ) {
+      case FDRuleOutcome::Dropped:
+        it = erase_fd_rule( it );
+        continue;
+      case FDRuleOutcome::Served:
+        if ( _dispatch == Dispatch::OneRule ) {
+          return Result::Success; /* only serve one rule on each iteration */
         }
-      }
+        served = true;
+        break;
+      case FDRuleOutcome::Kept:
+        break;
+    }
 
-      /* see if fd is a socket */
-      int socket_error = 0;
-      socklen_t optlen = sizeof( socket_error );
-      const int ret = getsockopt( this_rule.fd.fd_num(), SOL_SOCKET, SO_ERROR, &socket_error, &optlen );
-      if ( ret == -1 and errno == ENOTSOCK ) {
-        cerr << "error on polled file descriptor for rule \"" << _rule_categories.at( this_rule.category_id ).name
-             << "\"\n";
-      } else if ( ret == -1 ) {
-        throw unix_error( "getsockopt" );
-      } else if ( optlen != sizeof( socket_error ) ) {
-        throw runtime_error( "unexpected length from getsockopt: " + to_string( optlen ) );
-      } else if ( socket_error ) {
-        cerr << "error on polled socket for rule \"" << _rule_categories.at( this_rule.category_id ).name
-             << "\": " << strerror( socket_error ) << "\n";
-      }
+    ++it; // if we got here, it means we didn't call _fd_rules.erase()
+  }
 
-      this_rule.cancel();
-      it = _fd_rules.erase( it );
+  return Result::Success;
+}
+
+EventLoop::Result EventLoop::wait_epoll( const int timeout_ms )
+{
+  // Drop finished rules and note which interests changed. Registrations persist between calls,
+  // so only the changes cost a system call.
+  bool something_to_poll = false;
+  for ( auto it = _fd_rules.begin(); it != _fd_rules.end(); ) {
+    auto& this_rule = **it;
+
+    if ( this_rule.cancel_requested ) {
+      it = erase_fd_rule( it ); // cancelled externally (or already dropped): no cancellation callback
       continue;
     }
 
-    const auto poll_ready = static_cast<bool>( this_pollfd.revents & this_pollfd.events );
-    const auto poll_hup = static_cast<bool>( this_pollfd.revents & POLLHUP );
-    if ( poll_hup && ( ( this_pollfd.events && !poll_ready ) or ( this_rule.direction == Direction::Out ) ) ) {
-      // if we asked for the status, and the _only_ condition was a hangup, this FD is defunct:
-      //   - if it was POLLIN and nothing is readable, no more will ever be readable
-      //   - if it was POLLOUT, it will not be writable again
-      // additionally, consider FD defunct if rule will only query for Direction::Out
+    if ( ( this_rule.direction == Direction::In && this_rule.fd.eof() ) or this_rule.fd.closed() ) {
       this_rule.cancel();
-      it = _fd_rules.erase( it );
+      it = erase_fd_rule( it );
       continue;
     }
 
-    if ( poll_ready ) {
-      // we only want to call callback if revents includes the event we asked for
-      const auto count_before = this_rule.service_count();
-      this_rule.callback();
+    const bool interested = this_rule.interest();
+    if ( interested != this_rule.interested ) {
+      this_rule.interested = interested;
+      _epoll_dirty.push_back( this_rule.epoll_fd );
+    }
+    something_to_poll |= interested;
+    ++it;
+  }
 
-      if ( count_before == this_rule.service_count() and ( not this_rule.fd.closed() ) and this_rule.interest() ) {
-        throw runtime_error( "EventLoop: busy wait detected: rule \""
-                             + _rule_categories.at( this_rule.category_id ).name
-                             + "\" did not read/write fd and is still interested" );
-      }
+  // quit if there is nothing left to poll or wait for
+  if ( not something_to_poll and _timers.empty() ) {
+    return Result::Exit;
+  }
+
+  epoll_update_interests();
+
+  // one wakeup reports every ready fd
+  _epoll_events.resize( max<size_t>( _epoll_fds.size(), 1 ) );
+  const int ready = CheckSystemCall( "epoll_wait",
+                                     ::epoll_wait( _epoll->fd_num(),
+                                                   _epoll_events.data(),
+                                                   static_cast<int>( _epoll_events.size() ),
+                                                   wait_timeout( timeout_ms ) ) );
+  const bool timers_fired = _timers.advance_to( now_ms() ) > 0;
+  if ( ready == 0 ) {
+    return timers_fired ? Result::Success : Result::Timeout;
+  }
 
-      return Result::Success; /* only serve one rule on each iteration */
+  // epoll reports fds in the order they became ready; serve their rules in the order they were added, as
+  // poll does (rules that callbacks add on the way were not waited for, so they are not in the list)
+  _epoll_ready.clear();
+  for ( size_t i = 0; i < static_cast<size_t>( ready ); i++ ) {
+    const auto& entry = *static_cast<EpollFD*>( _epoll_events[i].data.ptr );
+    const uint32_t revents = _epoll_events[i].events;
+    for ( auto* rule : entry.rules ) {
+      _epoll_ready.emplace_back( rule, revents );
     }
+  }
+  ranges::sort( _epoll_ready, {}, []( const auto& ready_rule ) { return ready_rule.first->order; } );
 
-    ++it; // if we got here, it means we didn't call _fd_rules.erase()
+  bool served = false;
+  for ( const auto& [rule, revents] : _epoll_ready ) {
+    auto& this_rule = *rule;
+    if ( this_rule.cancel_requested ) {
+      continue;
+    }
+
+    uint32_t events = this_rule.interested ? static_cast<uint32_t>( this_rule.direction ) : 0;
+    if ( served and events != 0 and not this_rule.interest() ) {
+      events = 0; // an earlier callback in this pass took away the rule's interest
+    }
+    switch ( serve_fd_rule( this_rule, events, revents ) ) {
+      case FDRuleOutcome::Dropped:
+        this_rule.cancel_requested = true; // erased on the next call
+        break;
+      case FDRuleOutcome::Served:
+        if ( _dispatch == Dispatch::OneRule ) {
+          return Result::Success; /* only serve one rule on each iteration */
+        }
+        served = true;
+        break;
+      case FDRuleOutcome::Kept:
+        break;
+    }
   }
 
   return Result::Success;
 }
+
+EventLoop::FDRuleOutcome EventLoop::serve_fd_rule( FDRule& this_rule, const uint32_t events, const uint32_t revents )
+{
+  const auto poll_error = static_cast<bool>( revents & ( POLLERR | POLLNVAL ) );
+  if ( poll_error ) {
+    /* recoverable error? */
+    if ( not static_cast<bool>( revents & POLLNVAL ) ) {
+      if ( this_rule.recover() ) {
+        return FDRuleOutcome::Kept;
+      }
+    }
+
+    /* see if fd is a socket */
+    int socket_error = 0;
+    socklen_t optlen = sizeof( socket_error );
+    const int ret = getsockopt( this_rule.fd.fd_num(), SOL_SOCKET, SO_ERROR, &socket_error, &optlen );
+    if ( ret == -1 and errno == ENOTSOCK ) {
+      cerr << "error on polled file descriptor for rule \"" << _rule_categories.at( this_rule.category_id ).name
+           << "\"\n";
+    } else if ( ret == -1 ) {
+      throw unix_error( "getsockopt" );
+    } else if ( optlen != sizeof( socket_error ) ) {
+      throw runtime_error( "unexpected length from getsockopt: " + to_string( optlen ) );
+    } else if ( socket_error ) {
+      cerr << "error on polled socket for rule \"" << _rule_categories.at( this_rule.category_id ).name
+           << "\": " << strerror( socket_error ) << "\n";
+    }
+
+    this_rule.cancel();
+    return FDRuleOutcome::Dropped;
+  }
+
+  const auto poll_ready = static_cast<bool>( revents & events );
+  const auto poll_hup = static_cast<bool>( revents & POLLHUP );
+  if ( poll_hup && ( ( events && !poll_ready ) or ( this_rule.direction == Direction::Out ) ) ) {
+    // if we asked for the status, and the _only_ condition was a hangup, this FD is defunct:
+    //   - if it was POLLIN and nothing is readable, no more will ever be readable
+    //   - if it was POLLOUT, it will not be writable again
+    // additionally, consider FD defunct if rule will only query for Direction::Out
+    this_rule.cancel();
+    return FDRuleOutcome::Dropped;
+  }
+
+  if ( poll_ready ) {
+    // we only want to call callback if revents includes the event we asked for
+    const auto count_before = this_rule.service_count();
+    this_rule.callback();
+
+    if ( count_before == this_rule.service_count() and ( not this_rule.fd.closed() ) and this_rule.interest() ) {
+      throw runtime_error( "EventLoop: busy wait detected: rule \""
+                           + _rule_categories.at( this_rule.category_id ).name
+                           + "\" did not read/write fd and is still interested" );
+    }
+
+    return FDRuleOutcome::Served;
+  }
+
+  return FDRuleOutcome::Kept;
+}
 // NOLINTEND(*-signed-bitwise)
-// NOLINTEND(*-cognitive-complexity)
@@ -1,13 +1,19 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <list>
 #include <memory>
+#include <optional>
 #include <ostream>
 #include <poll.h>
 #include <string_view>
+#include <sys/epoll.h>
+#include <unordered_map>
+#include <vector>
 
 #include "file_descriptor.hh"
+#include "timer_wheel.hh"
 
 //! Waits for events on file descriptors and executes corresponding callbacks.
 class EventLoop
@@ -20,6 +26,31 @@ public:
     Out = POLLOUT //!< Callback will be triggered when Rule::fd is writable.
   };
 
+  //! How the loop waits for its file descriptors.
+  enum class Backend
+  {
+    Poll, //!< Build a pollfd for every rule and call [poll(2)](\ref man2::poll) on each iteration.
+    Epoll //!< Keep each fd registered with [epoll(7)](\ref man7::epoll) and update only the interests that
+          //!< changed, so the kernel's work per wakeup depends on the ready fds, not on the number of rules.
+  };
+
+  //! How many ready rules each call to EventLoop::wait_next_event serves.
+  enum class Dispatch
+  {
+    OneRule, //!< Run the first ready rule's callback and return.
+    AllReady //!< Run the callback of every rule that is ready, each at most once per call, in the order the
+             //!< rules were added; a rule that is still ready afterwards waits for the next call.
+  };
+
+  //! Returned by each call to EventLoop::wait_next_event.
+  enum class Result
+  {
+    Success, //!< At least one Rule was triggered.
+    Timeout, //!< No rules were triggered before timeout.
+    Exit     //!< All rules have been canceled or were uninterested, and no timer is pending; make no
+             //!< further calls to EventLoop::wait_next_event.
+  };
+
 private:
   using CallbackT = std::function<void( void )>;
   using InterestT = std::function<bool( void )>;
@@ -39,12 +70,18 @@ private:
     BasicRule( size_t s_category_id, InterestT s_interest, CallbackT s_callback );
   };
 
+  struct EpollFD;
+
   struct FDRule : public BasicRule
   {
     FileDescriptor fd;   //!< FileDescriptor to monitor for activity.
     Direction direction; //!< Direction::In for reading from fd, Direction::Out for writing to fd.
     CallbackT cancel;    //!< A callback that is called when the rule is cancelled (e.g. on hangup)
     InterestT recover;   //!< A callback that is called when the fd is ERR. Returns true to keep rule.
+    bool interested {};  //!< Result of interest() when the loop last checked it.
+    uint64_t order {};   //!< Rules are served in this order, the order they were added.
+
+    std::shared_ptr<EpollFD> epoll_fd {}; //!< The epoll registration of fd (Backend::Epoll only).
 
     FDRule( BasicRule&& base,
             FileDescriptor&& s_fd,
@@ -57,21 +94,56 @@ private:
     unsigned int service_count() const;
   };
 
+  //! One fd registered with epoll, shared by every rule that watches it (e.g. one rule In, one Out).
+  struct EpollFD
+  {
+    const void* handle;             //!< FileDescriptor::handle() of the registered fd.
+    int fd_num;                     //!< The registered descriptor number.
+    uint32_t registered_events {};  //!< Events epoll is currently asked to report.
+    std::vector<FDRule*> rules {};  //!< Rules watching this fd, in the order they were added.
+  };
+
+  //! What became of a rule after its fd reported events.
+  enum class FDRuleOutcome
+  {
+    Kept,   //!< The rule stays; its callback was not run.
+    Served, //!< The rule's callback was run.
+    Dropped //!< The rule was cancelled (its cancel callback has been called).
+  };
+
+  Backend _backend;
+  Dispatch _dispatch;
   std::vector<RuleCategory> _rule_categories {};
   std::list<std::shared_ptr<FDRule>> _fd_rules {};
   std::list<std::shared_ptr<BasicRule>> _non_fd_rules {};
 
-public:
-  EventLoop() { _rule_categories.reserve( 64 ); }
+  std::optional<FileDescriptor> _epoll {};                                 //!< The epoll instance (Backend::Epoll).
+  std::unordered_map<const void*, std::shared_ptr<EpollFD>> _epoll_fds {}; //!< Registrations by fd handle.
+  std::vector<std::shared_ptr<EpollFD>> _epoll_dirty {};                   //!< Registrations whose interests changed.
+  std::vector<epoll_event> _epoll_events {};                               //!< Output of epoll_wait.
+  std::vector<std::pair<FDRule*, uint32_t>> _epoll_ready {};               //!< Rules of ready fds, with the events.
+  uint64_t _next_rule_order {};                                            //!< FDRule::order of the next rule added.
 
-  //! Returned by each call to EventLoop::wait_next_event.
-  enum class Result
-  {
-    Success, //!< At least one Rule was triggered.
-    Timeout, //!< No rules were triggered before timeout.
-    Exit     //!< All rules have been canceled or were uninterested; make no further calls to
-             //!< EventLoop::wait_next_event.
-  };
+  TimerWheel _timers { now_ms() }; //!< Deadlines registered with add_timer().
+
+  //! How long poll or epoll_wait may sleep: `timeout_ms`, cut short by the next timer
+  int wait_timeout( int timeout_ms ) const;
+
+  void epoll_attach( FDRule& rule );
+  void epoll_detach( FDRule& rule );
+  void epoll_update_interests();
+
+  //! Erase a rule from _fd_rules (and from the epoll set).
+  std::list<std::shared_ptr<FDRule>>::iterator erase_fd_rule( std::list<std::shared_ptr<FDRule>>::iterator it );
+
+  //! Act on the `revents` reported for a rule that asked for `events`.
+  FDRuleOutcome serve_fd_rule( FDRule& rule, uint32_t events, uint32_t revents );
+
+  Result wait_poll( int timeout_ms );
+  Result wait_epoll( int timeout_ms );
+
+public:
+  explicit EventLoop( Backend backend = Backend::Poll, Dispatch dispatch = Dispatch::OneRule );
 
   size_t add_category( const std::string& name );
 
@@ -101,7 +173,18 @@ public:
     const CallbackT& callback,
     const InterestT& interest = [] { return true; } );
 
-  //! Calls [poll(2)](\ref man2::poll) and then executes callback for each ready fd.
+  //! Milliseconds on the steady clock: the time base of timers.
+  static uint64_t now_ms();
+
+  //! Run `callback` once, when now_ms() reaches `deadline_ms`. wait_next_event() sleeps no longer than
+  //! until the earliest deadline and counts a timer that fires as an event.
+  TimerWheel::TimerId add_timer( uint64_t deadline_ms, const CallbackT& callback );
+
+  //! Cancel a timer that has not fired yet.
+  void cancel_timer( TimerWheel::TimerId id ) { _timers.cancel( id ); }
+
+  //! Calls [poll(2)](\ref man2::poll) (or [epoll_wait(2)](\ref man2::epoll_wait)) and then executes the
+  //! callback of a ready fd (or of every ready fd, with Dispatch::AllReady).
   Result wait_next_event( int timeout_ms );
 
   // convenience function to add category and rule at the same time
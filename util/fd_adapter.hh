@@ -13,6 +13,10 @@
 //! \details See TCPOverIPv4OverTunFdAdapter for more information.
 class FdAdapterBase
 {
+public:
+  static constexpr uint16_t DEFAULT_MTU = 1500; //!< MTU of an Ethernet link
+  static constexpr size_t MAX_READ_BATCH = 32;   //!< Most datagrams taken by one batched read
+
 private:
   FdAdapterConfig _cfg {}; //!< Configuration values
   bool _listen = false;    //!< Is the connected TCP FSM in listen state?
@@ -37,6 +41,10 @@ public:
   //! \returns a mutable reference
   FdAdapterConfig& config_mut() { return _cfg; }
 
+  //! \brief Get the MTU of the link below the adapter
+  //! \returns the largest IP datagram the adapter can carry
+  uint16_t mtu() const { return DEFAULT_MTU; }
+
   //! Called periodically when time elapses
   void tick( const size_t unused [[maybe_unused]] ) {}
 };
@@ -3,9 +3,11 @@
 #include "exception.hh"
 
 #include <algorithm>
+#include <climits>
 #include <fcntl.h>
 #include <iostream>
 #include <stdexcept>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/uio.h>
@@ -115,8 +117,9 @@ void FileDescriptor::read( vector<string>& buffers )
     return;
   }
 
-  buffers.back().clear();
-  buffers.back().resize( kReadBufferSize );
+  if ( buffers.back().empty() ) {
+    buffers.back().resize( kReadBufferSize );
+  }
 
   vector<iovec> iovecs;
   iovecs.reserve(buffers.size());
@@ -129,6 +132,9 @@ void FileDescriptor::read( vector<string>& buffers )
   const ssize_t bytes_read = ::readv(fd_num(), iovecs.data(), static_cast<int>(iovecs.size()));
   if (bytes_read < 0) {
     if (internal_fd_->non_blocking_ and (errno == EAGAIN or errno == EINPROGRESS)) {
+      for ( auto& buf : buffers ) {
+        buf.clear();
+      }
       return;
     }
     throw unix_error {"read"};
@@ -136,6 +142,10 @@ void FileDescriptor::read( vector<string>& buffers )
 
   register_read();
 
+  if ( bytes_read == 0 and total_size != 0 ) {
+    internal_fd_->eof_ = true;
+  }
+
   if (bytes_read > static_cast<ssize_t>(total_size)) {
     throw runtime_error("read() read more than requested");
   }
@@ -151,6 +161,105 @@ void FileDescriptor::read( vector<string>& buffers )
   }
 }
 
+// Size the buffers of every datagram for a scatter-read and lay out their iovecs back to back
+static vector<iovec> read_iovecs(vector<vector<string>>& datagrams, size_t default_size)
+{
+  size_t count = 0;
+  for (auto& datagram : datagrams) {
+    if (not datagram.empty() and datagram.back().empty()) {
+      datagram.back().resize(default_size);
+    }
+    count += datagram.size();
+  }
+
+  vector<iovec> iovecs;
+  iovecs.reserve(count);
+  for (auto& datagram : datagrams) {
+    for (auto& buf : datagram) {
+      iovecs.push_back({buf.data(), buf.size()});
+    }
+  }
+  return iovecs;
+}
+
+// Trim a datagram's buffers to the `bytes_read` that landed in them
+static void trim_to(vector<string>& buffers, size_t bytes_read)
+{
+  for (auto& buf : buffers) {
+    if (bytes_read >= buf.size()) {
+      bytes_read -= buf.size();
+    } else {
+      buf.resize(bytes_read);
+      bytes_read = 0;
+    }
+  }
+}
+
+size_t FileDescriptor::read_datagrams(vector<vector<string>>& datagrams)
+{
+  vector<iovec> iovecs = read_iovecs(datagrams, kReadBufferSize);
+
+  size_t offset = 0;
+  size_t count = 0;
+  for (auto& datagram : datagrams) {
+    // Only the first read may block
+    if (count > 0 and not internal_fd_->non_blocking_) {
+      break;
+    }
+
+    const ssize_t bytes_read
+      = ::readv(fd_num(), iovecs.data() + offset, static_cast<int>(datagram.size()));
+    if (bytes_read < 0) {
+      if (internal_fd_->non_blocking_ and errno == EAGAIN) {
+        break;
+      }
+      throw unix_error {"readv"};
+    }
+    register_read();
+
+    if (bytes_read == 0 and not datagram.empty()) {
+      internal_fd_->eof_ = true;
+      break;
+    }
+
+    trim_to(datagram, bytes_read);
+    offset += datagram.size();
+    ++count;
+  }
+
+  return count;
+}
+
+size_t FileDescriptor::recv_datagrams(vector<vector<string>>& datagrams)
+{
+  vector<iovec> iovecs = read_iovecs(datagrams, kReadBufferSize);
+
+  vector<mmsghdr> headers(min<size_t>(datagrams.size(), UIO_MAXIOV));
+  size_t offset = 0;
+  for (size_t i = 0; i < headers.size(); i++) {
+    headers[i].msg_hdr.msg_iov = iovecs.data() + offset;
+    headers[i].msg_hdr.msg_iovlen = datagrams[i].size();
+    offset += datagrams[i].size();
+  }
+
+  // MSG_WAITFORONE: wait (on a blocking socket) for the first datagram, then take what is ready
+  const int ret = ::recvmmsg(
+    fd_num(), headers.data(), static_cast<unsigned>(headers.size()), MSG_WAITFORONE, nullptr);
+  if (ret < 0) {
+    if (internal_fd_->non_blocking_ and errno == EAGAIN) {
+      return 0;
+    }
+    throw unix_error {"recvmmsg"};
+  }
+  register_read();
+
+  const auto count = static_cast<size_t>(ret);
+  for (size_t i = 0; i < count; i++) {
+    trim_to(datagrams[i], headers[i].msg_len);
+  }
+  return count;
+}
+
 size_t FileDescriptor::write(string_view buffer)
 {
   return write(vector<string_view> {buffer});
@@ -176,6 +285,15 @@ size_t FileDescriptor::write( const vector<string_view>& buffers )
     total_size += x.size();
   }
 
+  // writev takes at most IOV_MAX buffers; anything beyond is left for the caller's next (partial) write
+  if ( iovecs.size() > IOV_MAX ) {
+    total_size = 0;
+    for ( size_t i = 0; i < IOV_MAX; i++ ) {
+      total_size += iovecs[i].iov_len;
+    }
+    iovecs.resize( IOV_MAX );
+  }
+
   const ssize_t bytes_written
     = CheckSystemCall("writev", ::writev(fd_num(), iovecs.data(), static_cast<int>(iovecs.size())));
   register_write();
@@ -191,6 +309,79 @@ size_t FileDescriptor::write( const vector<string_view>& buffers )
   return bytes_written;
 }
 
+// Lay out the iovecs of every datagram back to back, so a batch costs one allocation
+static vector<iovec> datagram_iovecs(const vector<vector<Buffer>>& datagrams)
+{
+  size_t count = 0;
+  for (const auto& datagram : datagrams) {
+    count += datagram.size();
+  }
+
+  vector<iovec> iovecs;
+  iovecs.reserve(count);
+  for (const auto& datagram : datagrams) {
+    for (const auto& buffer : datagram) {
+      const string_view view = buffer;
+      iovecs.push_back({const_cast<char*>(view.data()), view.size()}); // NOLINT(*-const-cast)
+    }
+  }
+  return iovecs;
+}
+
+size_t FileDescriptor::write_datagrams(const vector<vector<Buffer>>& datagrams)
+{
+  vector<iovec> iovecs = datagram_iovecs(datagrams);
+
+  size_t offset = 0;
+  size_t written = 0;
+  for (const auto& datagram : datagrams) {
+    const ssize_t bytes_written
+      = ::writev(fd_num(), iovecs.data() + offset, static_cast<int>(datagram.size()));
+    if (bytes_written < 0) {
+      if (internal_fd_->non_blocking_ and errno == EAGAIN) {
+        break;
+      }
+      throw unix_error {"writev"};
+    }
+    register_write();
+    offset += datagram.size();
+    ++written;
+  }
+
+  return written;
+}
+
+size_t FileDescriptor::send_datagrams(const vector<vector<Buffer>>& datagrams)
+{
+  vector<iovec> iovecs = datagram_iovecs(datagrams);
+
+  vector<mmsghdr> headers(datagrams.size());
+  size_t offset = 0;
+  for (size_t i = 0; i < datagrams.size(); i++) {
+    headers[i].msg_hdr.msg_iov = iovecs.data() + offset;
+    headers[i].msg_hdr.msg_iovlen = datagrams[i].size();
+    offset += datagrams[i].size();
+  }
+
+  // sendmmsg may stop short (and takes at most UIO_MAXIOV headers), so keep going until the
+  // batch is out or the socket is full
+  size_t sent = 0;
+  while (sent < headers.size()) {
+    const auto count = static_cast<unsigned>(min<size_t>(headers.size() - sent, UIO_MAXIOV));
+    const int ret = ::sendmmsg(fd_num(), headers.data() + sent, count, 0);
+    if (ret < 0) {
+      if (internal_fd_->non_blocking_ and errno == EAGAIN) {
+        break;
+      }
+      throw unix_error {"sendmmsg"};
+    }
+    register_write();
+    sent += ret;
+  }
+
+  return sent;
+}
+
 void FileDescriptor::set_blocking(bool blocking)
 {
   int flags = CheckSystemCall("fcntl", fcntl(fd_num(), F_GETFL)); // NOLINT(*-vararg)
@@ -65,7 +65,14 @@ public:
 
   // Read into `buffer`
   void read( std::string& buffer );
+  // Scatter-read into `buffers`, each filled up to its current size (an empty last buffer is
+  // first sized to kReadBufferSize); buffers are then trimmed to the bytes actually read
   void read( std::vector<std::string>& buffers );
+  // Read one datagram into each element of `datagrams` (sized as for the scatter-read above) until
+  // the fd would block; returns how many were read. A blocking fd only waits for the first.
+  size_t read_datagrams( std::vector<std::vector<std::string>>& datagrams );
+  // The same with recvmmsg, for datagram sockets
+  size_t recv_datagrams( std::vector<std::vector<std::string>>& datagrams );
 
   // Attempt to write a buffer
   // returns number of bytes written
@@ -73,6 +80,13 @@ public:
   size_t write( const std::vector<std::string_view>& buffers );
   size_t write( const std::vector<Buffer>& buffers );
 
+  // Write each datagram (the buffers serialize() produced for it) with its own writev, as a
+  // TUN/TAP device needs; returns the number of datagrams written before the fd would block
+  size_t write_datagrams( const std::vector<std::vector<Buffer>>& datagrams );
+  // Send the datagrams with as few sendmmsg calls as possible (the fd must be a connected
+  // datagram socket); returns the number sent before the socket would block
+  size_t send_datagrams( const std::vector<std::vector<Buffer>>& datagrams );
+
   // Close the underlying file descriptor
   void close() { internal_fd_->close(); }
 
@@ -92,6 +106,10 @@ public:
   unsigned int read_count() const { return internal_fd_->read_count_; }   // number of reads
   unsigned int write_count() const { return internal_fd_->write_count_; } // number of writes
 
+  // Identifies the FDWrapper shared by this FileDescriptor and its duplicates; unlike fd_num(), it
+  // cannot be reused by another file while any of them is alive
+  const void* handle() const { return internal_fd_.get(); }
+
   // Copy/move constructor/assignment operators
   // FileDescriptor can be moved, but cannot be copied implicitly (see duplicate())
   FileDescriptor(const FileDescriptor& other) = delete;            // copy construction is forbidden
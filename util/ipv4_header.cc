@@ -12,6 +12,11 @@ using namespace std;
 // Parse from string.
 void IPv4Header::parse(Parser& parser)
 {
+  // Sum the header where it lies in the input, before consuming it
+  InternetChecksum check;
+  const auto add_to_check = [&check](string_view chunk) { check.add(chunk); };
+  parser.input().for_each_chunk(add_to_check, IPv4Header::LENGTH);
+
   uint8_t first_byte {};
   parser.integer(first_byte);
   ver = first_byte >> 4;    // version
@@ -44,12 +49,12 @@ void IPv4Header::parse(Parser& parser)
     return;
   }
 
-  parser.remove_prefix( static_cast<uint64_t>( hlen ) * 4 - IPv4Header::LENGTH );
+  const uint64_t options_length = static_cast<uint64_t>( hlen ) * 4 - IPv4Header::LENGTH;
+  parser.input().for_each_chunk( add_to_check, options_length );
+  parser.remove_prefix( options_length );
 
   // Verify checksum
-  const uint16_t given_cksum = cksum;
-  compute_checksum();
-  if (cksum != given_cksum) {
+  if (check.value() != 0) {
     parser.set_error();
   }
 }
@@ -117,6 +122,30 @@ void IPv4Header::compute_checksum()
   cksum = check.value();
 }
 
+// TTL shares a 16-bit word of the header with the protocol
+void IPv4Header::set_ttl(const uint8_t new_ttl)
+{
+  const uint16_t old_word = (static_cast<uint16_t>(ttl) << 8) | proto;
+  ttl = new_ttl;
+  cksum = InternetChecksum::update(cksum, old_word, (static_cast<uint16_t>(ttl) << 8) | proto);
+}
+
+void IPv4Header::set_src(const uint32_t new_src)
+{
+  cksum = InternetChecksum::update(cksum, src >> 16, new_src >> 16);
+  cksum = InternetChecksum::update(
+    cksum, static_cast<uint16_t>(src), static_cast<uint16_t>(new_src));
+  src = new_src;
+}
+
+void IPv4Header::set_dst(const uint32_t new_dst)
+{
+  cksum = InternetChecksum::update(cksum, dst >> 16, new_dst >> 16);
+  cksum = InternetChecksum::update(
+    cksum, static_cast<uint16_t>(dst), static_cast<uint16_t>(new_dst));
+  dst = new_dst;
+}
+
 std::string IPv4Header::to_string() const
 {
   stringstream ss {};
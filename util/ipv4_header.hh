@@ -57,6 +57,11 @@ struct IPv4Header
   // Set checksum to correct value
   void compute_checksum();
 
+  // Change one field and adjust the checksum to match, without recomputing it (RFC 1624)
+  void set_ttl(uint8_t new_ttl);
+  void set_src(uint32_t new_src);
+  void set_dst(uint32_t new_dst);
+
   // Return a string containing a header in human-readable format
   std::string to_string() const;
 
@@ -5,9 +5,12 @@
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 
+#include <algorithm>
+#include <cstddef>
 #include <optional>
 #include <random>
 #include <utility>
+#include <vector>
 
 //! An adapter class that adds random dropping behavior to an FD adapter
 template<typename AdapterT>
@@ -49,6 +52,17 @@ public:
     return ret;
   }
 
+  //! \brief Read a batch from the underlying AdapterT instance, dropping each segment independently
+  //! \param[out] segs receives the segments that were kept
+  void read( std::vector<TCPSegment>& segs )
+  {
+    const auto first = static_cast<std::ptrdiff_t>( segs.size() );
+    _adapter.read( segs );
+    const auto dropped
+      = std::remove_if( segs.begin() + first, segs.end(), [&]( const TCPSegment& ) { return _should_drop( false ); } );
+    segs.erase( dropped, segs.end() );
+  }
+
   //! \brief Write to the underlying AdapterT instance, potentially dropping the datagram to be written
   //! \param[in] seg is the packet to either write or drop
   void write( TCPSegment& seg )
@@ -59,11 +73,21 @@ public:
     return _adapter.write( seg );
   }
 
+  //! \brief Write a batch to the underlying AdapterT instance, dropping each segment independently
+  //! \param[in] segs are the packets to either write or drop; dropped ones are removed
+  //! \returns the number of the remaining segments written (see AdapterT::write)
+  size_t write( std::vector<TCPSegment>& segs )
+  {
+    std::erase_if( segs, [&]( const TCPSegment& ) { return _should_drop( true ); } );
+    return _adapter.write( segs );
+  }
+
   //! \name
   //! Passthrough functions to the underlying AdapterT instance
 
   void set_listening( const bool l ) { _adapter.set_listening( l ); } //!< FdAdapterBase::set_listening passthrough
   const FdAdapterConfig& config() const { return _adapter.config(); } //!< FdAdapterBase::config passthrough
   FdAdapterConfig& config_mut() { return _adapter.config_mut(); }     //!< FdAdapterBase::config_mut passthrough
+  uint16_t mtu() const { return _adapter.mtu(); }                     //!< FdAdapterBase::mtu passthrough
   void tick( const size_t ms_since_last_tick ) { _adapter.tick( ms_since_last_tick ); }
 };
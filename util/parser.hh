@@ -45,6 +45,23 @@ class Parser
       return std::string_view {buffer_.front()}.substr(skip_);
     }
 
+    // Call `visit` on each stored chunk of (at most the first `len` bytes of) the input, in
+    // order, without copying or consuming anything
+    template<class F>
+    void for_each_chunk(F&& visit, uint64_t len = UINT64_MAX) const
+    {
+      uint64_t skip = skip_;
+      for (const auto& buffer : buffer_) {
+        if (len == 0) {
+          return;
+        }
+        const std::string_view chunk = std::string_view {buffer}.substr(skip, len);
+        visit(chunk);
+        len -= chunk.size();
+        skip = 0;
+      }
+    }
+
     void remove_prefix(uint64_t len)
     {
       while (len and not buffer_.empty()) {
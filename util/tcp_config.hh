@@ -1,6 +1,7 @@
 #pragma once
 
 #include "address.hh"
+#include "congestion_control.hh"
 #include "wrapping_integers.hh"
 
 #include <cstddef>
@@ -17,12 +18,29 @@ public:
   static constexpr uint16_t TIMEOUT_DFLT = 1000; //!< Default re-transmit timeout is 1 second
   static constexpr unsigned MAX_RETX_ATTEMPTS
     = 8; //!< Maximum re-transmit attempts before giving up
+  static constexpr uint16_t MIN_PEER_MSS = 48; //!< Sanity floor on a peer's MSS (Linux's tcp_min_snd_mss)
+  static constexpr uint64_t RTO_MIN_DFLT = 200;   //!< Default lower bound of the adaptive RTO, in ms (Linux's TCP_RTO_MIN)
+  static constexpr uint64_t RTO_MAX_DFLT = 60000; //!< Default upper bound of the adaptive RTO, in ms
+  static constexpr uint64_t MAX_HOLD_DFLT = 200;  //!< Default limit on holding back small segments, in ms
+  static constexpr uint64_t ACK_DELAY_DFLT = 40;  //!< Default limit on delaying an ACK, in ms
 
   uint16_t rt_timeout
     = TIMEOUT_DFLT; //!< Initial value of the retransmission timeout, in milliseconds
   size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes
   size_t send_capacity = DEFAULT_CAPACITY; //!< Sender capacity, in bytes
   std::optional<Wrap32> fixed_isn {};
+  std::optional<uint16_t> mss {}; //!< MSS to advertise (MAX_PAYLOAD_SIZE if unset; sockets derive it from the MTU)
+  bool sack = true; //!< Offer selective acknowledgments (SACK) to the peer
+  bool window_scaling = true; //!< Offer window scaling so receive windows can exceed 65,535 bytes
+  CongestionControlAlgorithm congestion_control
+    = CongestionControlAlgorithm::NEWRENO; //!< Algorithm that sizes the congestion window
+  bool adaptive_rto = true; //!< Compute the RTO from measured round-trip times (RFC 6298)
+  uint64_t rto_min = RTO_MIN_DFLT; //!< Lower bound of the adaptive RTO, in ms (kept above twice ack_delay)
+  uint64_t rto_max = RTO_MAX_DFLT; //!< Upper bound of the adaptive RTO, in milliseconds
+  bool nagle = false; //!< Coalesce small writes while data is unacknowledged (Nagle's algorithm)
+  uint64_t max_hold = MAX_HOLD_DFLT; //!< Longest time Nagle's algorithm or a cork holds data back, in ms
+  bool delayed_ack = true; //!< Acknowledge every second full-sized segment instead of every segment
+  uint64_t ack_delay = ACK_DELAY_DFLT; //!< Longest time an ACK may be delayed, in ms
 };
 
 //! Config for classes derived from FdAdapter
@@ -34,4 +52,14 @@ public:
 
   uint16_t loss_rate_dn = 0; //!< Downlink loss rate (for LossyFdAdapter)
   uint16_t loss_rate_up = 0; //!< Uplink loss rate (for LossyFdAdapter)
+
+  bool checksum_verified = false; //!< The link below already verified TCP checksums; don't check again
 };
+
+//! Largest TCP payload that fits in an IPv4 datagram of `mtu` bytes, leaving room for the
+//! IPv4 and TCP headers without options
+constexpr uint16_t mss_for_mtu( uint16_t mtu )
+{
+  constexpr uint16_t headers = 40;
+  return mtu > headers ? mtu - headers : 0;
+}
@@ -18,22 +18,31 @@
 
 using namespace std;
 
-static constexpr size_t TCP_TICK_MS = 10;
-
-static inline uint64_t timestamp_ms()
-{
-  static_assert( std::is_same<std::chrono::steady_clock::duration, std::chrono::nanoseconds>::value );
-
-  return std::chrono::steady_clock::now().time_since_epoch().count() / 1000000;
-}
+// Longest sleep with no TCP timer pending, so that an _abort from the owner is noticed
+static constexpr int TCP_MAX_IDLE_MS = 1000;
+static constexpr size_t MAX_READ_CHUNKS = 64; // iovecs per read from the owner's socket
 
 //! \param[in] condition is a function returning true if loop should continue
 template<typename AdaptT>
 void TCPMinnowSocket<AdaptT>::_tcp_loop( const function<bool()>& condition )
 {
-  auto base_time = timestamp_ms();
+  auto base_time = EventLoop::now_ms();
+  optional<TimerWheel::TimerId> wakeup;
   while ( condition() ) {
-    auto ret = _eventloop.wait_next_event( TCP_TICK_MS );
+    // Sleep until the next TCP deadline (retransmission, held-back segment or delayed ACK) rather
+    // than waking on a fixed tick. The timer only wakes the loop; the tick below does the work.
+    // The adapter needs no timer of its own: ARP entries expire on whichever tick comes next.
+    if ( wakeup.has_value() ) {
+      _eventloop.cancel_timer( wakeup.value() );
+      wakeup.reset();
+    }
+    if ( _tcp.has_value() and _tcp->active() ) {
+      if ( const auto delay = _tcp->ms_until_next_timer() ) {
+        wakeup = _eventloop.add_timer( base_time + delay.value(), [] {} );
+      }
+    }
+
+    auto ret = _eventloop.wait_next_event( TCP_MAX_IDLE_MS );
     if ( ret == EventLoop::Result::Exit or _abort ) {
       break;
     }
@@ -43,7 +52,7 @@ void TCPMinnowSocket<AdaptT>::_tcp_loop( const function<bool()>& condition )
     }
 
     if ( _tcp.value().active() ) {
-      const auto next_time = timestamp_ms();
+      const auto next_time = EventLoop::now_ms();
       _tcp.value().tick( next_time - base_time );
       collect_segments();
       _datagram_adapter.tick( next_time - base_time );
@@ -63,12 +72,19 @@ TCPMinnowSocket<AdaptT>::TCPMinnowSocket( pair<FileDescriptor, FileDescriptor> d
 {
   _thread_data.set_blocking( false );
   set_blocking( false );
+  // Batched reads drain the adapter until it would block
+  _datagram_adapter.fd().set_blocking( false );
 }
 
 template<typename AdaptT>
 void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
 {
-  _tcp.emplace( config );
+  // Unless told otherwise, advertise the largest MSS the adapter's link can carry
+  TCPConfig tcp_config = config;
+  if ( not tcp_config.mss.has_value() ) {
+    tcp_config.mss = mss_for_mtu( _datagram_adapter.mtu() );
+  }
+  _tcp.emplace( tcp_config );
 
   // Set up the event loop
 
@@ -94,8 +110,11 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     _datagram_adapter.fd(),
     Direction::In,
     [&] {
-      if ( auto seg = _datagram_adapter.read() ) {
-        _tcp->receive( move( seg.value() ) );
+      // Take every datagram that is ready, and reply once for the whole batch
+      incoming_segments_.clear();
+      _datagram_adapter.read( incoming_segments_ );
+      if ( not incoming_segments_.empty() ) {
+        _tcp->receive( incoming_segments_ );
         collect_segments();
       }
 
@@ -114,10 +133,21 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     _thread_data,
     Direction::In,
     [&] {
-      string data;
-      data.resize( _tcp->outbound_writer().available_capacity() );
-      _thread_data.read( data );
-      _tcp->outbound_writer().push( move( data ) );
+      // Read in payload-sized chunks: the outbound stream keeps each chunk as-is,
+      // so TCPSender can send it as a segment payload without copying
+      size_t capacity = _tcp->outbound_writer().available_capacity();
+      vector<string> chunks;
+      while ( capacity > 0 and chunks.size() < MAX_READ_CHUNKS ) {
+        chunks.emplace_back( min( capacity, _tcp->sender().mss() ), 0 );
+        capacity -= chunks.back().size();
+      }
+      _thread_data.read( chunks );
+      for ( auto& chunk : chunks ) {
+        if ( chunk.empty() ) {
+          break;
+        }
+        _tcp->outbound_writer().push( move( chunk ) );
+      }
 
       if ( _thread_data.eof() ) {
         _tcp->outbound_writer().close();
@@ -148,12 +178,13 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     Direction::Out,
     [&] {
       Reader& inbound = _tcp->inbound_reader();
-      // Write from the inbound_stream into
-      // the pipe, handling the possibility of a partial
+      // Write everything buffered in the inbound_stream into
+      // the pipe with one writev, handling the possibility of a partial
       // write (i.e., only pop what was actually written).
       if ( inbound.bytes_buffered() ) {
-        const std::string_view buffer = inbound.peek();
-        const auto bytes_written = _thread_data.write( buffer );
+        vector<string_view> buffers;
+        inbound.peek_iov( buffers );
+        const auto bytes_written = _thread_data.write( buffers );
         inbound.pop( bytes_written );
       }
 
@@ -178,10 +209,10 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     _datagram_adapter.fd(),
     Direction::Out,
     [&] {
-      while ( not outgoing_segments_.empty() ) {
-        _datagram_adapter.write( outgoing_segments_.front() );
-        outgoing_segments_.pop();
-      }
+      // Segments the adapter could not write without blocking wait for the next POLLOUT
+      const size_t written = _datagram_adapter.write( outgoing_segments_ );
+      outgoing_segments_.erase( outgoing_segments_.begin(),
+                                outgoing_segments_.begin() + static_cast<ptrdiff_t>( written ) );
     },
     [&] { return not outgoing_segments_.empty(); } );
 }
@@ -312,9 +343,7 @@ void TCPMinnowSocket<AdaptT>::collect_segments()
     return;
   }
 
-  while ( auto seg = _tcp->maybe_send() ) {
-    outgoing_segments_.push( move( seg.value() ) );
-  }
+  _tcp->maybe_send( outgoing_segments_ );
 }
 
 //! Specialization of TCPMinnowSocket for TCPOverIPv4OverTunFdAdapter
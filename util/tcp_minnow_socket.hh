@@ -34,11 +34,14 @@ private:
   //! TCP state machine
   std::optional<TCPPeer> _tcp {};
 
+  //! Segments read from the network in one batch
+  std::vector<TCPSegment> incoming_segments_ {};
+
   //! Segments queued to be sent on the network
-  std::queue<TCPSegment> outgoing_segments_ {};
+  std::vector<TCPSegment> outgoing_segments_ {};
 
   //! eventloop that handles all the events (new inbound datagram, new outbound bytes, new inbound bytes)
-  EventLoop _eventloop {};
+  EventLoop _eventloop { EventLoop::Backend::Epoll, EventLoop::Dispatch::AllReady };
 
   //! Process events while specified condition is true
   void _tcp_loop( const std::function<bool()>& condition );
@@ -43,7 +43,7 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const InternetDatagra
 
   // is the payload a valid TCP segment?
   TCPSegment tcp_seg;
-  if ( not parse( tcp_seg, ip_dgram.payload, ip_dgram.header.pseudo_checksum() ) ) {
+  if ( not parse( tcp_seg, ip_dgram.payload, ip_dgram.header.pseudo_checksum(), config().checksum_verified ) ) {
     return {};
   }
 
@@ -84,12 +84,11 @@ InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip( TCPSegment& seg )
   InternetDatagram ip_dgram;
   ip_dgram.header.src = config().source.ipv4_numeric();
   ip_dgram.header.dst = config().destination.ipv4_numeric();
-  ip_dgram.header.len = ip_dgram.header.hlen * 4 + 20 /* tcp header len */ + seg.sender_message.payload.size();
+  ip_dgram.header.len = ip_dgram.header.hlen * 4 + seg.header_length() + seg.sender_message.payload.size();
 
   // set payload, calculating TCP checksum using information from IP header
-  seg.compute_checksum( ip_dgram.header.pseudo_checksum() );
+  ip_dgram.payload = seg.serialize_with_checksum( ip_dgram.header.pseudo_checksum() );
   ip_dgram.header.compute_checksum();
-  ip_dgram.payload = serialize( seg );
 
   return ip_dgram;
 }
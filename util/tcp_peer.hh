@@ -7,27 +7,139 @@
 #include "tcp_sender.hh"
 #include "tcp_sender_message.hh"
 
+#include <algorithm>
+#include <cstdint>
 #include <optional>
+#include <vector>
 
 class TCPPeer
 {
   TCPConfig cfg_;
-  TCPSender sender_ { cfg_.rt_timeout, cfg_.fixed_isn };
+  TCPSender sender_ { cfg_.rt_timeout,
+                     cfg_.fixed_isn,
+                     cfg_.congestion_control,
+                     cfg_.adaptive_rto ? std::optional<RTOBounds> { rto_bounds( cfg_ ) } : std::nullopt };
   TCPReceiver receiver_ {};
   Reassembler reassembler_ {};
 
-  ByteStream outbound_stream_ { cfg_.send_capacity }, inbound_stream_ { cfg_.recv_capacity };
+  // The outbound stream keeps pushed chunks as-is so TCPSender can use them as payloads without copying
+  ByteStream outbound_stream_ { cfg_.send_capacity, ByteStream::Storage::Chunked };
+  ByteStream inbound_stream_ { cfg_.recv_capacity };
 
   bool need_send_ {};
+  bool peer_sack_permitted_ {}; // Did the peer's SYN carry the SACK-permitted option?
+
+  // Delayed ACK (RFC 1122 section 4.2.3.2, RFC 5681 section 4.2): in-order data is acknowledged
+  // after every second full-sized segment or once cfg_.ack_delay has passed
+  bool ack_pending_ {};
+  uint64_t ack_pending_ms_ {};    // How long has the ACK been delayed?
+  uint64_t unacked_bytes_ {};     // Payload received since our last ACK
+  uint64_t largest_payload_ {};   // Largest payload received, taken as the peer's full segment size
+
+  // Window scaling (RFC 7323) is in effect once both SYNs carried the option
+  std::optional<uint8_t> peer_window_shift_ {}; // The peer's shift, from its SYN
+  uint8_t window_shift_ { window_shift_for( cfg_.recv_capacity ) }; // Our shift, offered on our SYN
+
+  // Largest payload we accept, advertised in the MSS option on our SYN
+  uint16_t mss() const { return cfg_.mss.value_or( TCPConfig::MAX_PAYLOAD_SIZE ); }
+
+  // Smallest shift that lets a 16-bit window field describe `capacity` bytes
+  static uint8_t window_shift_for( uint64_t capacity )
+  {
+    uint8_t shift = 0;
+    while ( shift < TCPReceiverMessage::MAX_WINDOW_SHIFT and ( capacity >> shift ) > UINT16_MAX ) {
+      shift++;
+    }
+    return shift;
+  }
+
+  bool window_scaling() const { return cfg_.window_scaling and peer_window_shift_.has_value(); }
+
+  std::vector<TCPSenderMessage> sender_msgs_ {}; // Scratch space for batched maybe_send()
+
+  // Get outgoing TCPReceiverMessage from receiver, with SACK blocks if both sides agreed to them.
+  TCPReceiverMessage make_receiver_message() const
+  {
+    const bool use_sack = cfg_.sack and peer_sack_permitted_;
+    return use_sack ? receiver_.send( inbound_stream_.writer(), reassembler_ )
+                    : receiver_.send( inbound_stream_.writer() );
+  }
+
+  // Combine an outgoing TCPSenderMessage and TCPReceiverMessage into a segment, with the options
+  // that go with them. The segment carries any delayed ACK with it.
+  TCPSegment make_segment( TCPSenderMessage&& sender_msg, const TCPReceiverMessage& receiver_msg )
+  {
+    ack_pending_ = false;
+    ack_pending_ms_ = 0;
+    unacked_bytes_ = 0;
+    TCPSegment seg {
+      std::move( sender_msg ), receiver_msg, outbound_stream_.reader().has_error() or inbound_stream_.reader().has_error() };
+    // Offer SACK on our SYN; when answering a SYN, only if the peer offered it too
+    seg.sack_permitted = seg.sender_message.SYN and cfg_.sack and ( peer_sack_permitted_ or not receiver_msg.ackno );
+    // Likewise for window scaling; windows in later segments are sent shifted right by our shift
+    if ( seg.sender_message.SYN ) {
+      if ( cfg_.window_scaling and ( peer_window_shift_.has_value() or not receiver_msg.ackno ) ) {
+        seg.window_scale = window_shift_;
+      }
+      seg.receiver_message.window_size = std::min<uint32_t>( seg.receiver_message.window_size, UINT16_MAX );
+      seg.mss = mss();
+    } else if ( window_scaling() ) {
+      seg.receiver_message.window_size
+        = std::min<uint32_t>( seg.receiver_message.window_size >> window_shift_, UINT16_MAX );
+    }
+    // The MSS leaves out options (RFC 6691), so drop SACK blocks that would make the segment too big
+    while ( not seg.receiver_message.sack_blocks.empty()
+            and seg.header_length() - TCPSegment::HEADER_LENGTH + seg.sender_message.payload.size() > sender_.mss() ) {
+      seg.receiver_message.sack_blocks.pop_back();
+    }
+    return seg;
+  }
 
 public:
-  explicit TCPPeer( const TCPConfig& cfg ) : cfg_( cfg ) {}
+  explicit TCPPeer( const TCPConfig& cfg ) : cfg_( cfg )
+  {
+    sender_.set_nagle( cfg_.nagle );
+    sender_.set_max_hold_ms( cfg_.max_hold );
+  }
 
   Writer& outbound_writer() { return outbound_stream_.writer(); }
   Reader& inbound_reader() { return inbound_stream_.reader(); }
 
   void push() { sender_.push( outbound_stream_.reader() ); };
-  void tick( uint64_t ms_since_last_tick ) { sender_.tick( ms_since_last_tick ); }
+
+  //! Hold back partial segments until uncork() (or until TCPConfig::max_hold passes), so that a
+  //! series of small writes goes out in full-sized segments
+  void cork() { sender_.set_corked( true ); }
+  void uncork() { sender_.set_corked( false ); }
+
+  //! Bounds of the adaptive RTO for `cfg`. The RTO must not expire while the peer is only delaying
+  //! its ACK, so the lower bound stays clear of a full ack_delay plus a round trip.
+  static RTOBounds rto_bounds( const TCPConfig& cfg )
+  {
+    const uint64_t min = std::max( cfg.rto_min, 2 * cfg.ack_delay );
+    return { min, std::max( min, cfg.rto_max ) };
+  }
+
+  void tick( uint64_t ms_since_last_tick )
+  {
+    sender_.tick( ms_since_last_tick );
+    if ( ack_pending_ ) {
+      ack_pending_ms_ += ms_since_last_tick;
+      need_send_ |= ( ack_pending_ms_ >= cfg_.ack_delay );
+    }
+  }
+
+  //! Milliseconds until tick() next has work to do (a retransmission, a held-back segment or a
+  //! delayed ACK), or nothing if no timer is pending
+  std::optional<uint64_t> ms_until_next_timer() const
+  {
+    std::optional<uint64_t> next = sender_.ms_until_next_timer();
+    if ( ack_pending_ ) {
+      const uint64_t ack_ms = ack_pending_ms_ >= cfg_.ack_delay ? 0 : cfg_.ack_delay - ack_pending_ms_;
+      next = std::min( next.value_or( ack_ms ), ack_ms );
+    }
+    return next;
+  }
 
   bool has_ackno() const { return receiver_.send( inbound_stream_.writer() ).ackno.has_value(); }
 
@@ -47,22 +159,64 @@ public:
       return;
     }
 
-    // Give incoming TCPReceiverMessage to sender.
-    sender_.receive( seg.receiver_message );
+    if ( seg.sender_message.SYN ) {
+      // Only the first SYN sets up the connection; a retransmitted one must not reset the congestion
+      // window through set_mss() or change the negotiated options
+      if ( not receiver_.send( inbound_stream_.writer() ).ackno.has_value() ) {
+        peer_sack_permitted_ = seg.sack_permitted;
+        peer_window_shift_ = seg.window_scale;
+        // Segments we send carry at most the smaller of our and the peer's MSS. A peer that didn't send
+        // the option gets the conservative MAX_PAYLOAD_SIZE that was used before MSS negotiation. An
+        // absurdly small MSS (even 0) is raised to MIN_PEER_MSS so that the sender cannot stall.
+        const uint16_t peer_mss = seg.mss.value_or( TCPConfig::MAX_PAYLOAD_SIZE );
+        sender_.set_mss( std::min( mss(), std::max( peer_mss, TCPConfig::MIN_PEER_MSS ) ) );
+      }
+    } else if ( window_scaling() ) {
+      // The window in a SYN is never scaled
+      seg.receiver_message.window_size <<= peer_window_shift_.value();
+    }
+
+    // Give incoming TCPReceiverMessage to sender. Only an ACK that carries nothing else may count as
+    // a duplicate ACK.
+    sender_.receive( seg.receiver_message, seg.sender_message.sequence_length() == 0 );
 
     // Give incoming TCPSenderMessage to receiver.
     // If SenderMessage is non-empty or a keep-alive, make sure to reply.
-    need_send_ |= ( seg.sender_message.sequence_length() > 0 );
     const auto our_ackno = receiver_.send( inbound_stream_.writer() ).ackno;
-    need_send_ |= ( our_ackno.has_value() and seg.sender_message.seqno + 1 == our_ackno.value() );
+    const bool keep_alive = our_ackno.has_value() and seg.sender_message.seqno + 1 == our_ackno.value();
+    const bool has_data = seg.sender_message.sequence_length() > 0;
+
+    // Only in-order data that leaves no hole behind may wait for its ACK; a SYN, a FIN, out-of-order
+    // data and data that fills a hole are acknowledged right away
+    const bool may_delay = cfg_.delayed_ack and our_ackno.has_value() and seg.sender_message.seqno == our_ackno.value()
+                           and not seg.sender_message.SYN and not seg.sender_message.FIN
+                           and reassembler_.bytes_pending() == 0;
+    const uint64_t payload_size = seg.sender_message.payload.size();
 
     receiver_.receive( std::move( seg.sender_message ), reassembler_, inbound_stream_.writer() );
+
+    if ( keep_alive or ( has_data and not may_delay ) ) {
+      need_send_ = true;
+    } else if ( has_data ) {
+      unacked_bytes_ += payload_size;
+      largest_payload_ = std::max( largest_payload_, payload_size );
+      ack_pending_ = true;
+      need_send_ |= ( unacked_bytes_ >= 2 * largest_payload_ );
+    }
+  }
+
+  //! Receive a batch of segments that arrived together. Whatever acknowledgment they call for is
+  //! decided once, after the whole batch, and goes out in one segment on the next maybe_send().
+  void receive( std::vector<TCPSegment>& segs )
+  {
+    for ( auto& seg : segs ) {
+      receive( std::move( seg ) );
+    }
   }
 
   std::optional<TCPSegment> maybe_send()
   {
-    // Get outgoing TCPReceiverMessage from receiver.
-    auto receiver_msg = receiver_.send( inbound_stream_.writer() );
+    const TCPReceiverMessage receiver_msg = make_receiver_message();
 
     // If connection is alive, push stream to TCPSender.
     if ( receiver_msg.ackno.has_value() ) {
@@ -78,15 +232,37 @@ public:
 
     need_send_ = false;
 
-    // Send the segment
     if ( sender_msg.has_value() ) {
-      return TCPSegment {
-        sender_msg.value(), receiver_msg, outbound_stream_.reader().has_error() or inbound_reader().has_error() };
+      return make_segment( std::move( sender_msg.value() ), receiver_msg );
     }
 
     return {};
   }
 
+  //! Append every segment that can be sent now (new data and retransmissions) to `out`. The
+  //! segments share their payloads with TCPSender's copies kept for retransmission.
+  void maybe_send( std::vector<TCPSegment>& out )
+  {
+    const TCPReceiverMessage receiver_msg = make_receiver_message();
+
+    if ( receiver_msg.ackno.has_value() ) {
+      push();
+    }
+
+    sender_msgs_.clear();
+    sender_.maybe_send( sender_msgs_ );
+
+    if ( need_send_ and sender_msgs_.empty() ) {
+      sender_msgs_.push_back( sender_.send_empty_message() );
+    }
+
+    need_send_ = false;
+
+    for ( auto& sender_msg : sender_msgs_ ) {
+      out.push_back( make_segment( std::move( sender_msg ), receiver_msg ) );
+    }
+  }
+
   // Testing interface
   const TCPReceiver& receiver() const { return receiver_; }
   const TCPSender& sender() const { return sender_; }
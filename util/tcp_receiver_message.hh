@@ -2,7 +2,11 @@
 
 #include "wrapping_integers.hh"
 
+#include <cstddef>
+#include <cstdint>
 #include <optional>
+#include <utility>
+#include <vector>
 
 /*
  * The TCPReceiverMessage structure contains the information sent from a TCP receiver to its sender.
@@ -14,12 +18,24 @@
  * Sequence Number.
  *
  * 2) The window size. This is the number of sequence numbers that the TCP receiver is interested
- *    to receive, starting from the ackno if present. The maximum value is 65,535 (UINT16_MAX from
- *    the <cstdint> header).
+ *    to receive, starting from the ackno if present. The TCP header carries only 16 bits of it;
+ *    larger windows need the [window scale](\ref rfc::rfc7323) option, and the largest window
+ *    it can express is MAX_WINDOW_SIZE (65,535 shifted left by 14 bits).
+ *
+ * 3) Optional selective acknowledgments ([SACK](\ref rfc::rfc2018)): blocks of sequence numbers
+ *    beyond the ackno that the receiver already holds, each given as [left edge, right edge).
+ *    Empty unless both peers agreed to use SACK.
  */
 
 struct TCPReceiverMessage
 {
+  // Most SACK blocks that fit in the TCP header's options
+  static constexpr size_t MAX_SACK_BLOCKS = 4;
+  // Largest window scale shift, and the largest window it allows (RFC 7323 section 2.3)
+  static constexpr uint8_t MAX_WINDOW_SHIFT = 14;
+  static constexpr uint32_t MAX_WINDOW_SIZE = uint32_t {UINT16_MAX} << MAX_WINDOW_SHIFT;
+
   std::optional<Wrap32> ackno {};
-  uint16_t window_size {};
+  uint32_t window_size {};
+  std::vector<std::pair<Wrap32, Wrap32>> sack_blocks {};
 };
@@ -2,21 +2,165 @@
 #include "checksum.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <cstddef>
+#include <string>
+#include <vector>
 
 static constexpr uint32_t TCPHeaderMinLen = 5; // 32-bit words
+static constexpr size_t TCPOptionsMaxLen = 40;  // bytes
+static constexpr size_t TCPChecksumOffset = 16; // bytes into the header
+
+// Option kinds
+static constexpr uint8_t TCPOptionEnd = 0;
+static constexpr uint8_t TCPOptionNop = 1;
+static constexpr uint8_t TCPOptionMSS = 2;
+static constexpr uint8_t TCPOptionWindowScale = 3;
+static constexpr uint8_t TCPOptionSackPermitted = 4;
+static constexpr uint8_t TCPOptionSack = 5;
 
 using namespace std;
 
-void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum )
+class Wrap32Serializable : public Wrap32
+{
+public:
+  uint32_t raw_value() const { return raw_value_; }
+};
+
+static void append_integer( string& out, uint32_t val, size_t len )
+{
+  for ( size_t i = 0; i < len; i++ ) {
+    out.push_back( static_cast<char>( val >> ( ( len - i - 1 ) * 8 ) ) );
+  }
+}
+
+//! Length of the MSS, SACK-permitted and window scale options, each padded to 4 bytes
+static size_t syn_options_length( const TCPSegment& seg )
+{
+  return ( seg.mss.has_value() ? 4 : 0 ) + ( seg.sack_permitted ? 4 : 0 ) + ( seg.window_scale.has_value() ? 4 : 0 );
+}
+
+//! Number of SACK blocks that fit in the option space after `used` bytes of other options
+static size_t sack_blocks_that_fit( const TCPSegment& seg, size_t used )
 {
-  {
-    /* verify checksum */
-    Parser parser2 = parser;
-    Buffer all_remaining;
-    parser2.all_remaining( all_remaining );
+  const size_t room = TCPOptionsMaxLen - used;
+  return min( seg.receiver_message.sack_blocks.size(), room < 4 ? 0 : ( room - 4 ) / 8 );
+}
+
+//! \details Options are padded with leading NOPs so that multi-byte values stay 32-bit aligned,
+//! as the RFCs recommend. SACK blocks that don't fit in the header are left out.
+static string serialize_options( const TCPSegment& seg )
+{
+  string options;
+  if ( seg.mss.has_value() ) {
+    append_integer( options, TCPOptionMSS, 1 );
+    append_integer( options, 4, 1 );
+    append_integer( options, seg.mss.value(), 2 );
+  }
+  if ( seg.sack_permitted ) {
+    append_integer( options, TCPOptionNop, 1 );
+    append_integer( options, TCPOptionNop, 1 );
+    append_integer( options, TCPOptionSackPermitted, 1 );
+    append_integer( options, 2, 1 );
+  }
+  if ( seg.window_scale.has_value() ) {
+    append_integer( options, TCPOptionNop, 1 );
+    append_integer( options, TCPOptionWindowScale, 1 );
+    append_integer( options, 3, 1 );
+    append_integer( options, seg.window_scale.value(), 1 );
+  }
+
+  const auto& blocks = seg.receiver_message.sack_blocks;
+  const size_t num_blocks = sack_blocks_that_fit( seg, options.size() );
+  if ( num_blocks > 0 ) {
+    append_integer( options, TCPOptionNop, 1 );
+    append_integer( options, TCPOptionNop, 1 );
+    append_integer( options, TCPOptionSack, 1 );
+    append_integer( options, 2 + 8 * num_blocks, 1 );
+    for ( size_t i = 0; i < num_blocks; i++ ) {
+      append_integer( options, Wrap32Serializable { blocks[i].first }.raw_value(), 4 );
+      append_integer( options, Wrap32Serializable { blocks[i].second }.raw_value(), 4 );
+    }
+  }
+
+  options.resize( ( options.size() + 3 ) / 4 * 4, TCPOptionEnd ); // pad to a 32-bit boundary
+  return options;
+}
+
+//! \details Unknown options are skipped; a malformed option list marks the parser as failed.
+static void parse_options( Parser& parser, size_t len, TCPSegment& seg )
+{
+  string options( len, 0 );
+  parser.string( options );
+  if ( parser.has_error() ) {
+    return;
+  }
+
+  Parser p { { Buffer { move( options ) } } };
+  while ( not p.input().empty() and not p.has_error() ) {
+    uint8_t kind {};
+    p.integer( kind );
+    if ( kind == TCPOptionEnd ) {
+      break;
+    }
+    if ( kind == TCPOptionNop ) {
+      continue;
+    }
+
+    uint8_t option_len {};
+    p.integer( option_len );
+    if ( option_len < 2 or option_len - 2U > p.input().size() ) {
+      parser.set_error();
+      return;
+    }
+
+    if ( kind == TCPOptionMSS and option_len == 4 ) {
+      uint16_t mss {};
+      p.integer( mss );
+      seg.mss = mss;
+      continue;
+    } else if ( kind == TCPOptionSackPermitted ) {
+      seg.sack_permitted = true;
+    } else if ( kind == TCPOptionWindowScale and option_len == 3 ) {
+      uint8_t shift {};
+      p.integer( shift );
+      // Larger shifts are treated as the maximum (RFC 7323 section 2.3)
+      seg.window_scale = min( shift, TCPReceiverMessage::MAX_WINDOW_SHIFT );
+      continue;
+    } else if ( kind == TCPOptionSack and ( option_len - 2 ) % 8 == 0 ) {
+      for ( size_t i = 0; i < ( option_len - 2U ) / 8; i++ ) {
+        uint32_t left {};
+        uint32_t right {};
+        p.integer( left );
+        p.integer( right );
+        seg.receiver_message.sack_blocks.emplace_back( Wrap32 { left }, Wrap32 { right } );
+      }
+      continue;
+    }
+    p.remove_prefix( option_len - 2 );
+  }
+
+  if ( p.has_error() ) {
+    parser.set_error();
+  }
+}
+
+//! \details Computed from the options present, as serialize_options() lays them out, so that
+//! sizing a segment does not serialize (and allocate) its options
+size_t TCPSegment::header_length() const
+{
+  const size_t syn_options = syn_options_length( *this );
+  const size_t num_blocks = sack_blocks_that_fit( *this, syn_options );
+  const size_t options = syn_options + ( num_blocks > 0 ? 4 + 8 * num_blocks : 0 );
+  return HEADER_LENGTH + ( options + 3 ) / 4 * 4;
+}
+
+void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum, bool checksum_verified )
+{
+  if ( not checksum_verified ) {
+    /* verify checksum over the remaining input where it lies */
     InternetChecksum check { datagram_layer_pseudo_checksum };
-    check.add( all_remaining );
+    parser.input().for_each_chunk( [&check]( std::string_view chunk ) { check.add( chunk ); } );
     if ( check.value() ) {
       parser.set_error();
       return;
@@ -48,48 +192,58 @@ void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum
   sender_message.SYN = octet & 0b0000'0010;
   sender_message.FIN = octet & 0b0000'0001;
 
-  parser.integer( receiver_message.window_size );
+  parser.integer( raw16 );
+  receiver_message.window_size = raw16;
   parser.integer( udinfo.cksum );
   parser.integer( raw16 ); // urgent pointer
 
-  // skip any options or anything extra in the header
   if ( data_offset < TCPHeaderMinLen ) {
     parser.set_error();
+    return;
   }
-  parser.remove_prefix( data_offset * 4 - TCPHeaderMinLen * 4 );
+  parse_options( parser, data_offset * 4 - TCPHeaderMinLen * 4, *this );
 
   parser.all_remaining( sender_message.payload );
 }
 
-class Wrap32Serializable : public Wrap32
-{
-public:
-  uint32_t raw_value() const { return raw_value_; }
-};
-
 void TCPSegment::serialize( Serializer& serializer ) const
 {
+  const string options = serialize_options( *this );
+
   serializer.integer( udinfo.src_port );
   serializer.integer( udinfo.dst_port );
   serializer.integer( Wrap32Serializable { sender_message.seqno }.raw_value() );
   serializer.integer( Wrap32Serializable { receiver_message.ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
-  serializer.integer( uint8_t { TCPHeaderMinLen << 4 } ); // data offset
+  serializer.integer( static_cast<uint8_t>( ( TCPHeaderMinLen + options.size() / 4 ) << 4 ) ); // data offset
   const uint8_t flags = ( receiver_message.ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
                         | ( sender_message.SYN ? 0b0000'0010U : 0 ) | ( sender_message.FIN ? 0b0000'0001U : 0 );
   serializer.integer( flags );
-  serializer.integer( receiver_message.window_size );
+  serializer.integer( static_cast<uint16_t>( min<uint32_t>( receiver_message.window_size, UINT16_MAX ) ) );
   serializer.integer( udinfo.cksum );
   serializer.integer( uint16_t { 0 } ); // urgent pointer
+  for ( const char c : options ) {
+    serializer.integer( static_cast<uint8_t>( c ) );
+  }
   serializer.buffer( sender_message.payload );
 }
 
-void TCPSegment::compute_checksum( uint32_t datagram_layer_pseudo_checksum )
+vector<Buffer> TCPSegment::serialize_with_checksum( uint32_t datagram_layer_pseudo_checksum )
 {
   udinfo.cksum = 0;
-  Serializer s;
-  serialize( s );
+  vector<Buffer> output = ::serialize( *this );
 
   InternetChecksum check { datagram_layer_pseudo_checksum };
-  check.add( s.output() );
+  check.add( output );
   udinfo.cksum = check.value();
+
+  // The header was just written into a fresh Buffer (ahead of the shared payload); patch it in place
+  string& header = output.front();
+  header.at( TCPChecksumOffset ) = static_cast<char>( udinfo.cksum >> 8 );
+  header.at( TCPChecksumOffset + 1 ) = static_cast<char>( udinfo.cksum );
+  return output;
+}
+
+void TCPSegment::compute_checksum( uint32_t datagram_layer_pseudo_checksum )
+{
+  serialize_with_checksum( datagram_layer_pseudo_checksum );
 }
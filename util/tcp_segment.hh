@@ -5,15 +5,38 @@
 #include "tcp_sender_message.hh"
 #include "udinfo.hh"
 
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+//! \details On the wire, receiver_message.window_size is the 16-bit window field as is. Scaling
+//! it by the negotiated window scale shift is up to the connection (see TCPPeer); serialize()
+//! clamps larger values to 65,535.
 struct TCPSegment
 {
+  static constexpr size_t HEADER_LENGTH = 20; // TCP header length, not including options
+
   TCPSenderMessage sender_message {};
   TCPReceiverMessage receiver_message {};
   bool reset {}; // Connection experienced an abnormal error and should be shut down
   UserDatagramInfo udinfo {};
 
-  void parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum );
+  // Options
+  std::optional<uint16_t> mss {};         // Maximum segment size option (only meaningful on a SYN)
+  bool sack_permitted {};                 // SACK-permitted option (only meaningful on a SYN)
+  std::optional<uint8_t> window_scale {}; // Window scale option shift (only meaningful on a SYN)
+
+  // Length of the serialized TCP header, including options
+  size_t header_length() const;
+
+  // If `checksum_verified`, the layer below has already checked the checksum and parse() skips it
+  void parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum, bool checksum_verified = false );
   void serialize( Serializer& serializer ) const;
 
   void compute_checksum( uint32_t datagram_layer_pseudo_checksum );
+
+  // Set the checksum and serialize in one pass: the header is written once, and the payload is
+  // read only to checksum it. Returns the same buffers as serialize() would after compute_checksum().
+  std::vector<Buffer> serialize_with_checksum( uint32_t datagram_layer_pseudo_checksum );
 };
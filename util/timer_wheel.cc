@@ -0,0 +1,135 @@
+#include "timer_wheel.hh"
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+using namespace std;
+
+TimerWheel::TimerId TimerWheel::schedule( const uint64_t deadline_ms, CallbackT callback )
+{
+  const TimerId id = _next_id++;
+  _timers.emplace( id, Timer { deadline_ms, move( callback ) } );
+  place( id, deadline_ms );
+  return id;
+}
+
+void TimerWheel::place( const TimerId id, const uint64_t deadline_ms )
+{
+  // A timer that is already due goes in the current slot, which runs on the next advance
+  if ( deadline_ms <= _now_ms ) {
+    _levels[0][digit( _now_ms, 0 )].push_back( id );
+    ++_level_sizes[0];
+    return;
+  }
+
+  const size_t level = ( bit_width( deadline_ms ^ _now_ms ) - 1 ) / SLOT_BITS;
+  if ( level >= LEVELS ) {
+    _overflow.push_back( id );
+    return;
+  }
+
+  _levels[level][digit( deadline_ms, level )].push_back( id );
+  ++_level_sizes[level];
+}
+
+// Move the timers of the level's current slot down, now that the current time has reached it
+void TimerWheel::cascade( const size_t level )
+{
+  Slot ids;
+  swap( ids, _levels[level][digit( _now_ms, level )] );
+  _level_sizes[level] -= ids.size();
+  for ( const TimerId id : ids ) {
+    if ( const auto it = _timers.find( id ); it != _timers.end() ) {
+      place( id, it->second.deadline_ms );
+    }
+  }
+}
+
+size_t TimerWheel::run_current_slot()
+{
+  size_t fired = 0;
+  // A callback that schedules a timer which is already due puts it back in this slot, so keep going
+  // until the slot stays empty
+  Slot ids;
+  while ( not _levels[0][digit( _now_ms, 0 )].empty() ) {
+    ids.clear();
+    swap( ids, _levels[0][digit( _now_ms, 0 )] );
+    _level_sizes[0] -= ids.size();
+
+    for ( const TimerId id : ids ) {
+      const auto it = _timers.find( id );
+      if ( it == _timers.end() ) {
+        continue; // cancelled
+      }
+      // the callback may schedule or cancel timers, so take it out of the map first
+      const CallbackT callback = move( it->second.callback );
+      _timers.erase( it );
+      callback();
+      ++fired;
+    }
+  }
+  return fired;
+}
+
+size_t TimerWheel::advance_to( const uint64_t now_ms )
+{
+  size_t fired = run_current_slot();
+  while ( _now_ms < now_ms ) {
+    // With nothing on the lowest level, skip ahead to the next 64 ms boundary (or the target)
+    const uint64_t step = _level_sizes[0] == 0 ? min( now_ms - _now_ms, SLOTS - digit( _now_ms, 0 ) ) : 1;
+    _now_ms += step;
+
+    if ( digit( _now_ms, 0 ) == 0 ) {
+      // Crossed into a new block: refill from every level whose lower digits all rolled over,
+      // highest first so its timers can keep moving down
+      size_t highest = 0;
+      while ( highest + 1 < LEVELS and digit( _now_ms, highest ) == 0 ) {
+        ++highest;
+      }
+      if ( highest + 1 == LEVELS and digit( _now_ms, highest ) == 0 ) {
+        Slot ids;
+        swap( ids, _overflow );
+        for ( const TimerId id : ids ) {
+          if ( const auto it = _timers.find( id ); it != _timers.end() ) {
+            place( id, it->second.deadline_ms );
+          }
+        }
+      }
+      for ( size_t level = highest; level > 0; --level ) {
+        cascade( level );
+      }
+    }
+
+    fired += run_current_slot();
+  }
+  return fired;
+}
+
+optional<uint64_t> TimerWheel::next_deadline() const
+{
+  // Every timer on a level is due before every timer on the levels above it, and on the lowest
+  // level slots are in deadline order, so the first slot holding a live timer has the earliest
+  optional<uint64_t> earliest;
+  const auto earliest_in = [&]( const Slot& ids ) {
+    for ( const TimerId id : ids ) {
+      if ( const auto it = _timers.find( id ); it != _timers.end() ) {
+        earliest = min( earliest.value_or( UINT64_MAX ), it->second.deadline_ms );
+      }
+    }
+    return earliest.has_value();
+  };
+
+  for ( size_t level = 0; level < LEVELS; ++level ) {
+    if ( _level_sizes[level] == 0 ) {
+      continue;
+    }
+    for ( size_t slot = digit( _now_ms, level ); slot < SLOTS; ++slot ) {
+      if ( earliest_in( _levels[level][slot] ) ) {
+        return earliest;
+      }
+    }
+  }
+  earliest_in( _overflow );
+  return earliest;
+}
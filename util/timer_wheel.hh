@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+//! \brief A hierarchical timer wheel with millisecond slots
+//! \details Four levels of 64 slots cover deadlines up to 2^24 ms (about 4.6 hours) past the wheel's
+//! current time; later deadlines wait in an overflow list. A timer sits on the level of the highest
+//! 6-bit digit in which its deadline differs from the current time, and moves down a level each time
+//! the current time reaches that digit. Scheduling and cancelling are O(1); advancing costs O(1) per
+//! 64 ms of idle time plus O(1) per timer that moves or fires.
+class TimerWheel
+{
+public:
+  using TimerId = uint64_t;
+  using CallbackT = std::function<void( void )>;
+
+private:
+  static constexpr size_t SLOT_BITS = 6;
+  static constexpr size_t SLOTS = 1 << SLOT_BITS;
+  static constexpr size_t LEVELS = 4;
+
+  struct Timer
+  {
+    uint64_t deadline_ms;
+    CallbackT callback;
+  };
+
+  using Slot = std::vector<TimerId>;
+
+  uint64_t _now_ms;                                            //!< Time the wheel has advanced to
+  TimerId _next_id { 1 };                                      //!< Id of the next timer scheduled
+  std::unordered_map<TimerId, Timer> _timers {};               //!< Pending timers; cancelled ones are erased
+  std::array<std::array<Slot, SLOTS>, LEVELS> _levels {};      //!< Ids per slot (may include cancelled ids)
+  std::array<size_t, LEVELS> _level_sizes {};                  //!< Ids placed on each level
+  Slot _overflow {};                                           //!< Ids of timers beyond the last level
+
+  static size_t digit( uint64_t ms, size_t level ) { return ( ms >> ( level * SLOT_BITS ) ) % SLOTS; }
+
+  void place( TimerId id, uint64_t deadline_ms );
+  void cascade( size_t level );
+  size_t run_current_slot();
+
+public:
+  //! Start the wheel at `now_ms`
+  explicit TimerWheel( uint64_t now_ms = 0 ) : _now_ms( now_ms ) {}
+
+  //! Run `callback` once the wheel advances to `deadline_ms` (at once, on the next advance, if it is past)
+  TimerId schedule( uint64_t deadline_ms, CallbackT callback );
+
+  //! Forget a timer that has not fired yet
+  void cancel( TimerId id ) { _timers.erase( id ); }
+
+  //! Advance the wheel to `now_ms`, running the callback of every timer that is due (including one that a
+  //! callback schedules with a deadline that has already passed)
+  //! \returns the number of timers that fired
+  size_t advance_to( uint64_t now_ms );
+
+  //! The earliest pending deadline, if any timer is pending
+  std::optional<uint64_t> next_deadline() const;
+
+  bool empty() const { return _timers.empty(); }
+  uint64_t now_ms() const { return _now_ms; }
+};
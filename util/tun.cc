@@ -6,6 +6,7 @@
 #include <linux/if.h>
 #include <linux/if_tun.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
 
 static constexpr const char* CLONEDEV = "/dev/net/tun";
 
@@ -22,7 +23,7 @@ using namespace std;
 //! as root before calling this function.
 
 TunTapFD::TunTapFD( const string& devname, const bool is_tun )
-  : FileDescriptor( ::CheckSystemCall( "open", open( CLONEDEV, O_RDWR | O_CLOEXEC ) ) )
+  : FileDescriptor( ::CheckSystemCall( "open", open( CLONEDEV, O_RDWR | O_CLOEXEC ) ) ), _mtu()
 {
   struct ifreq tun_req
   {};
@@ -35,4 +36,9 @@ TunTapFD::TunTapFD( const string& devname, const bool is_tun )
   tun_req.ifr_name[IFNAMSIZ - 1] = '\0';
 
   CheckSystemCall( "ioctl", ioctl( fd_num(), TUNSETIFF, static_cast<void*>( &tun_req ) ) );
+
+  // The TUN/TAP character device doesn't answer interface ioctls, so ask through a socket
+  const FileDescriptor sock { CheckSystemCall( "socket", socket( AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0 ) ) };
+  CheckSystemCall( "ioctl", ioctl( sock.fd_num(), SIOCGIFMTU, static_cast<void*>( &tun_req ) ) );
+  _mtu = static_cast<uint16_t>( tun_req.ifr_mtu );
 }
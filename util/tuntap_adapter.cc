@@ -3,6 +3,22 @@
 
 using namespace std;
 
+namespace {
+
+//! Ready a read slot for the next datagram: buffers of the fixed header sizes, then an empty one that
+//! the read sizes to hold the rest
+void reset_read_slot( vector<string>& slot, initializer_list<size_t> header_sizes )
+{
+  slot.resize( header_sizes.size() + 1 );
+  auto buf = slot.begin();
+  for ( const size_t size : header_sizes ) {
+    ( buf++ )->resize( size );
+  }
+  buf->clear();
+}
+
+} // namespace
+
 optional<TCPSegment> TCPOverIPv4OverTunFdAdapter::read()
 {
   vector<string> strs( 2 );
@@ -17,6 +33,42 @@ optional<TCPSegment> TCPOverIPv4OverTunFdAdapter::read()
   return {};
 }
 
+//! \param[out] segs receives the TCP segments read
+void TCPOverIPv4OverTunFdAdapter::read( vector<TCPSegment>& segs )
+{
+  // The slots keep their storage (and size) from batch to batch; each datagram is copied out at its
+  // own size, and only the slots a batch trimmed are sized again
+  if ( _read_slots.empty() ) {
+    _read_slots.resize( MAX_READ_BATCH );
+    for ( auto& slot : _read_slots ) {
+      reset_read_slot( slot, { IPv4Header::LENGTH } );
+    }
+  }
+
+  const size_t count = _tun.read_datagrams( _read_slots );
+  for ( size_t i = 0; i < count; i++ ) {
+    InternetDatagram ip_dgram;
+    const vector<Buffer> buffers = { _read_slots[i].at( 0 ), _read_slots[i].at( 1 ) };
+    reset_read_slot( _read_slots[i], { IPv4Header::LENGTH } );
+    if ( not parse( ip_dgram, buffers ) ) {
+      continue;
+    }
+    if ( auto seg = unwrap_tcp_in_ip( ip_dgram ) ) {
+      segs.push_back( move( seg.value() ) );
+    }
+  }
+}
+
+//! \param[in] segs the TCPSegments to send
+size_t TCPOverIPv4OverTunFdAdapter::write( vector<TCPSegment>& segs )
+{
+  _datagrams.clear();
+  for ( auto& seg : segs ) {
+    _datagrams.push_back( serialize( wrap_tcp_in_ip( seg ) ) );
+  }
+  return _tun.write_datagrams( _datagrams );
+}
+
 //! \param[in] tap Raw network device that will be owned by the adapter
 //! \param[in] eth_address Ethernet address (local address) of the adapter
 //! \param[in] ip_address IP address (local address) of the adapter
@@ -41,9 +93,46 @@ optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read()
   strs.at( 1 ).resize( IPv4Header::LENGTH );
   _tap.read( strs );
 
-  EthernetFrame frame;
   vector<Buffer> buffers;
   ranges::transform( strs, back_inserter( buffers ), identity() );
+  auto seg = receive_frame( buffers );
+
+  // The incoming frame may have caused the NetworkInterface to send a frame.
+  send_pending();
+
+  return seg;
+}
+
+//! \param[out] segs receives the TCP segments read
+void TCPOverIPv4OverEthernetAdapter::read( vector<TCPSegment>& segs )
+{
+  // The slots keep their storage (and size) from batch to batch; each frame is copied out at its own
+  // size, and only the slots a batch trimmed are sized again
+  if ( _read_slots.empty() ) {
+    _read_slots.resize( MAX_READ_BATCH );
+    for ( auto& slot : _read_slots ) {
+      reset_read_slot( slot, { EthernetHeader::LENGTH, IPv4Header::LENGTH } );
+    }
+  }
+
+  const size_t count = _tap.read_datagrams( _read_slots );
+  for ( size_t i = 0; i < count; i++ ) {
+    vector<Buffer> buffers;
+    ranges::transform( _read_slots[i], back_inserter( buffers ), identity() );
+    reset_read_slot( _read_slots[i], { EthernetHeader::LENGTH, IPv4Header::LENGTH } );
+    if ( auto seg = receive_frame( buffers ) ) {
+      segs.push_back( move( seg.value() ) );
+    }
+  }
+
+  // Send whatever the batch of frames caused the NetworkInterface to send, all together
+  send_pending();
+}
+
+//! \param[in] buffers a serialized Ethernet frame
+optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::receive_frame( const vector<Buffer>& buffers )
+{
+  EthernetFrame frame;
   if ( not parse( frame, buffers ) ) {
     return {};
   }
@@ -51,9 +140,6 @@ optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read()
   // Give the frame to the NetworkInterface. Get back an Internet datagram if frame was carrying one.
   optional<InternetDatagram> ip_dgram = _interface.recv_frame( frame );
 
-  // The incoming frame may have caused the NetworkInterface to send a frame.
-  send_pending();
-
   // Try to interpret IPv4 datagram as TCP
   if ( ip_dgram ) {
     return unwrap_tcp_in_ip( ip_dgram.value() );
@@ -75,10 +161,25 @@ void TCPOverIPv4OverEthernetAdapter::write( TCPSegment& seg )
   send_pending();
 }
 
+//! \param[in] segs the TCPSegments to send
+size_t TCPOverIPv4OverEthernetAdapter::write( vector<TCPSegment>& segs )
+{
+  for ( auto& seg : segs ) {
+    _interface.send_datagram( wrap_tcp_in_ip( seg ), _next_hop );
+  }
+  send_pending();
+  return segs.size();
+}
+
 void TCPOverIPv4OverEthernetAdapter::send_pending()
 {
+  // Frames left over from a write that would have blocked go first
   while ( auto frame = _interface.maybe_send() ) {
-    _tap.write( serialize( frame.value() ) );
+    _frames.push_back( serialize( frame.value() ) );
+  }
+  if ( not _frames.empty() ) {
+    const size_t written = _tap.write_datagrams( _frames );
+    _frames.erase( _frames.begin(), _frames.begin() + static_cast<ptrdiff_t>( written ) );
   }
 }
 
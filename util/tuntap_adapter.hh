@@ -7,8 +7,10 @@
 #include "tun.hh"
 
 #include <optional>
+#include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 //! \brief A FD adapter for IPv4 datagrams read from and written to a TUN device
 class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter
@@ -16,6 +18,9 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter
 private:
   TunFD _tun;
 
+  std::vector<std::vector<Buffer>> _datagrams {}; //!< Serialized datagrams of the batch being written
+  std::vector<std::vector<std::string>> _read_slots {}; //!< Reusable buffers for batched reads
+
 public:
   //! Construct from a TunFD
   explicit TCPOverIPv4OverTunFdAdapter( TunFD&& tun ) : _tun( std::move( tun ) ) {}
@@ -23,9 +28,19 @@ public:
   //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
   std::optional<TCPSegment> read();
 
+  //! Reads every ready datagram (up to MAX_READ_BATCH) and appends the TCP segments for this connection to `segs`
+  void read( std::vector<TCPSegment>& segs );
+
   //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
   void write( TCPSegment& seg ) { _tun.write( serialize( wrap_tcp_in_ip( seg ) ) ); }
 
+  //! Writes a batch of TCP segments to the TUN device, one datagram each
+  //! \returns the number of segments written before the device would block; the caller keeps the rest
+  size_t write( std::vector<TCPSegment>& segs );
+
+  //! The TUN device's MTU
+  uint16_t mtu() const { return _tun.mtu(); }
+
   //! Access the underlying TUN device
   explicit operator TunFD&() { return _tun; }
 
@@ -49,6 +64,11 @@ private:
 
   Address _next_hop; //!< IP address of the next hop
 
+  std::vector<std::vector<Buffer>> _frames {}; //!< Serialized frames waiting to be written
+  std::vector<std::vector<std::string>> _read_slots {}; //!< Reusable buffers for batched reads
+
+  std::optional<TCPSegment> receive_frame( const std::vector<Buffer>& buffers ); //!< Handles one frame
+
   void send_pending(); //!< Sends any pending Ethernet frames
 
 public:
@@ -60,12 +80,23 @@ public:
   //! Attempts to read and parse an Ethernet frame containing an IPv4 datagram that contains a TCP segment
   std::optional<TCPSegment> read();
 
+  //! Reads every ready frame (up to MAX_READ_BATCH) and appends the TCP segments for this connection to `segs`
+  void read( std::vector<TCPSegment>& segs );
+
   //! Sends a TCP segment (in an IPv4 datagram, in an Ethernet frame).
   void write( TCPSegment& seg );
 
+  //! Sends a batch of TCP segments, writing the resulting frames together. Frames the device
+  //! can't take yet stay queued and go out first on the next write, read or tick.
+  //! \returns the number of segments accepted (all of them)
+  size_t write( std::vector<TCPSegment>& segs );
+
   //! Called periodically when time elapses
   void tick( size_t ms_since_last_tick );
 
+  //! The TAP device's MTU
+  uint16_t mtu() const { return _tap.mtu(); }
+
   //! Access the underlying raw Ethernet connection
   explicit operator TapFD&() { return _tap; }
 